@@ -0,0 +1,398 @@
+////////////////////////////////////////////////////////////////////////
+// fleet.cpp
+// Fleet Aggregator Source File
+// by: Aistheta Gleason
+////////////////////////////////////////////////////////////////////////
+// Safety Note: Read the README!!! Keep Battery in well ventilated area
+////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////
+// Copyright and License
+////////////////////////////////////////////////////////////////////////
+// Copyright 2022, Aistheta (Adam) Gleason
+////////////////////////////////////////////////////////////////////////
+// This program is free software: you can redistribute it and/or modify 
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or 
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// (LICENSE) along with this program. If not, see 
+// https://www.gnu.org/licenses/
+
+
+////////////////////////////////////////////////////////////////////////
+// Polls several chargers over their serial consoles and merges their
+// status into one log. Each round sends the console "t" command to
+// every unit and reads back its one line reply
+//   T,uptime_ms,state,fault,duty_cycle,v_solar_mV,v_battery_mV,p_mW
+// and writes one row per unit (plus a fleet total) stamped with the
+// round time. Board uptimes are mapped onto the aggregator clock so
+// rows can be lined up by when the board took them (t_board_ms).
+// Build from the repo root:
+//   g++ -O2 -Wall Fleet/fleet.cpp -o fleet
+// Usage: fleet [options] [NAME=]PORT ...
+//   --period MS       poll interval (default 1000)
+//   --timeout MS      reply timeout per round (default period/2)
+//   --rounds N        stop after N rounds (default 0, run until killed)
+//   --baud B          serial baud rate (default 115200, CONSOLE_BAUD)
+//   --boot MS         no requests for MS after a port opens, the board
+//                     resets on the DTR edge and sits in the
+//                     bootloader (default 2000, 0 for a pty)
+//   --log FILE        merged CSV log (default stdout)
+// Events (unit lost/back, state and fault changes) go to stderr. The
+// simulator stands in for boards with --pty LINK --realtime, see
+// fleet_sim.sh in the repo root.
+////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+
+////////////////////////////////////////////////////////////////////////
+// Constants
+////////////////////////////////////////////////////////////////////////
+// Maximum Units
+#define FLEET_MAX 32
+// Reply Line Buffer (bytes)
+#define FLEET_LINE 128
+// Clock Offset Smoothing (rounds)
+#define FLEET_OFFSET_N 8
+// Bootloader Window after the DTR Reset (ms)
+#define FLEET_BOOT_MS 2000
+// Charger States (STATES order in mppt.h)
+#define STATE_DONE_CHG 3
+
+////////////////////////////////////////////////////////////////////////
+// Type Definitions
+////////////////////////////////////////////////////////////////////////
+// One Telemetry Reply
+typedef struct _telemetry {
+  unsigned long uptime_ms;
+  int state, fault, duty;
+  long v_solar_mv, v_battery_mv, p_mw;
+} TELEMETRY;
+// One Charger
+typedef struct _unit {
+  // Name in the log and Serial Port
+  const char *name, *port;
+  // Port fd (-1 = closed)
+  int fd;
+  // No requests until (ms), the board is in its bootloader
+  double t_ready;
+  bool booting;
+  // Reply Line Buffer
+  char line[FLEET_LINE];
+  unsigned int line_n;
+  // Reply this Round, and when it was asked and answered (ms)
+  bool replied;
+  TELEMETRY t;
+  double t_sent, t_rx;
+  // Board to Aggregator Clock Offset (ms), valid once seen
+  double offset;
+  bool synced;
+  // Last Reply (for reboot and change detection), Rounds missed in a row
+  TELEMETRY last;
+  bool seen;
+  unsigned int missed;
+} UNIT;
+
+////////////////////////////////////////////////////////////////////////
+// Global Variables
+////////////////////////////////////////////////////////////////////////
+// Units
+static UNIT units[FLEET_MAX];
+static int n_units;
+// Aggregator Clock Start
+static struct timespec t0;
+// Bootloader Window (ms)
+static double boot_ms = FLEET_BOOT_MS;
+
+////////////////////////////////////////////////////////////////////////
+// Functions
+////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////
+// now_ms() function
+// Aggregator clock (ms since start)
+////////////////////////////////////////////////////////////////////////
+static double now_ms() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (t.tv_sec - t0.tv_sec) * 1e3 + (t.tv_nsec - t0.tv_nsec) * 1e-6;
+}
+
+////////////////////////////////////////////////////////////////////////
+// baud_speed() function
+// termios speed for a baud rate (0 if unsupported)
+////////////////////////////////////////////////////////////////////////
+static speed_t baud_speed(long baud) {
+  switch (baud) {
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+  }
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// unit_open() function
+// Opens a unit's port raw and non-blocking, returns 0 on failure.
+// Opening raises DTR, which resets an UNO class board, so requests
+// wait out the bootloader. HUPCL is cleared so DTR stays up when the
+// port closes and a later reopen doesn't reset the board again.
+////////////////////////////////////////////////////////////////////////
+static bool unit_open(UNIT *u, speed_t speed) {
+  struct termios tio;
+  u->fd = open(u->port, O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (u->fd < 0) return 0;
+  if (tcgetattr(u->fd, &tio) == 0) {
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    // Ignore modem lines (a pty has none), keep DTR up on close
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~HUPCL;
+    tcsetattr(u->fd, TCSANOW, &tio);
+  }
+  u->line_n = 0;
+  u->t_ready = now_ms() + boot_ms;
+  return 1;
+}
+
+////////////////////////////////////////////////////////////////////////
+// unit_close() function
+// Drops a unit's port, reopened next round
+////////////////////////////////////////////////////////////////////////
+static void unit_close(UNIT *u) {
+  if (u->fd >= 0) close(u->fd);
+  u->fd = -1;
+  u->synced = 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// parse_reply() function
+// Parses a "T,..." line, returns 0 for anything else (console chatter)
+////////////////////////////////////////////////////////////////////////
+static bool parse_reply(const char *line, TELEMETRY *t) {
+  return sscanf(line, "T,%lu,%d,%d,%d,%ld,%ld,%ld", &t->uptime_ms, &t->state, &t->fault, &t->duty,
+                &t->v_solar_mv, &t->v_battery_mv, &t->p_mw) == 7;
+}
+
+////////////////////////////////////////////////////////////////////////
+// unit_read() function
+// Reads what a unit sent, keeps the first reply line of the round.
+// Returns 0 if the port went away.
+////////////////////////////////////////////////////////////////////////
+static bool unit_read(UNIT *u) {
+  char buf[64];
+  ssize_t n = read(u->fd, buf, sizeof(buf));
+  if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) return 0;
+  for (ssize_t k = 0; k < n; k++) {
+    if (buf[k] == '\n' || buf[k] == '\r') {
+      u->line[u->line_n] = 0;
+      if (!u->replied && parse_reply(u->line, &u->t)) {
+        u->replied = 1;
+        u->t_rx = now_ms();
+      }
+      u->line_n = 0;
+    } else if (u->line_n < FLEET_LINE - 1) u->line[u->line_n++] = buf[k];
+  }
+  return 1;
+}
+
+////////////////////////////////////////////////////////////////////////
+// unit_sync() function
+// Maps board uptime onto the aggregator clock. The board answered
+// somewhere between sending and receiving, take the middle and smooth
+// it (serial latency jitter), start over when the board rebooted.
+////////////////////////////////////////////////////////////////////////
+static void unit_sync(UNIT *u) {
+  double offset = (u->t_sent + u->t_rx) / 2 - u->t.uptime_ms;
+  if (!u->synced || (u->seen && u->t.uptime_ms < u->last.uptime_ms)) {
+    u->offset = offset;
+    u->synced = 1;
+  } else u->offset += (offset - u->offset) / FLEET_OFFSET_N;
+}
+
+////////////////////////////////////////////////////////////////////////
+// unit_events() function
+// Reports a unit coming and going, rebooting, and state/fault changes
+////////////////////////////////////////////////////////////////////////
+static void unit_events(UNIT *u, double t) {
+  if (u->booting) return;
+  if (!u->replied) {
+    if (u->missed++ == 0 && u->seen) fprintf(stderr, "%.0f %s: no reply\n", t, u->name);
+    return;
+  }
+  if (!u->seen || u->missed) fprintf(stderr, "%.0f %s: up (uptime %lu ms)\n", t, u->name, u->t.uptime_ms);
+  else if (u->t.uptime_ms < u->last.uptime_ms) fprintf(stderr, "%.0f %s: rebooted\n", t, u->name);
+  if (u->seen && u->t.fault != u->last.fault) {
+    if (u->t.fault) fprintf(stderr, "%.0f %s: FAULT %d\n", t, u->name, u->t.fault);
+    else fprintf(stderr, "%.0f %s: fault cleared\n", t, u->name);
+  }
+  if (u->seen && u->t.state != u->last.state && (u->t.state == STATE_DONE_CHG || u->last.state == STATE_DONE_CHG)) {
+    fprintf(stderr, "%.0f %s: %s\n", t, u->name, u->t.state == STATE_DONE_CHG ? "stopped" : "charging");
+  }
+  u->missed = 0;
+  u->seen = 1;
+  u->last = u->t;
+}
+
+////////////////////////////////////////////////////////////////////////
+// poll_round() function
+// Asks every unit for telemetry and collects replies until all are in
+// or the timeout passes
+////////////////////////////////////////////////////////////////////////
+static void poll_round(speed_t speed, double timeout_ms) {
+  struct pollfd pfd[FLEET_MAX];
+  UNIT *pu[FLEET_MAX];
+  int n, waiting;
+  double t_end;
+  // Send Requests
+  for (int k = 0; k < n_units; k++) {
+    UNIT *u = &units[k];
+    u->replied = u->booting = 0;
+    if (u->fd < 0 && !unit_open(u, speed)) continue;
+    // Bootloader chatter is dropped with the flush below
+    u->booting = now_ms() < u->t_ready;
+    if (u->booting) continue;
+    // Drop chatter from before the request
+    tcflush(u->fd, TCIFLUSH);
+    u->line_n = 0;
+    u->t_sent = now_ms();
+    if (write(u->fd, "t\n", 2) != 2) unit_close(u);
+  }
+  // Collect Replies
+  t_end = now_ms() + timeout_ms;
+  while (now_ms() < t_end) {
+    n = waiting = 0;
+    for (int k = 0; k < n_units; k++) {
+      if (units[k].fd < 0 || units[k].replied || units[k].booting) continue;
+      pfd[n].fd = units[k].fd;
+      pfd[n].events = POLLIN;
+      pu[n++] = &units[k];
+      waiting++;
+    }
+    if (!waiting) break;
+    if (poll(pfd, n, (int) (t_end - now_ms()) + 1) <= 0) continue;
+    for (int k = 0; k < n; k++) {
+      if (pfd[k].revents & (POLLIN | POLLHUP | POLLERR)) {
+        if (!unit_read(pu[k])) unit_close(pu[k]);
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// log_round() function
+// One CSV row per unit and a fleet total, all at the round time
+////////////////////////////////////////////////////////////////////////
+static void log_round(FILE *log, double t) {
+  long p_mw = 0;
+  int n_ok = 0;
+  for (int k = 0; k < n_units; k++) {
+    UNIT *u = &units[k];
+    if (u->replied) {
+      unit_sync(u);
+      fprintf(log, "%.0f,%s,ok,%lu,%.0f,%d,%d,%d,%.3f,%.3f,%.3f,%.0f\n", t, u->name, u->t.uptime_ms,
+              u->t.uptime_ms + u->offset, u->t.state, u->t.fault, u->t.duty, u->t.v_solar_mv * 1e-3,
+              u->t.v_battery_mv * 1e-3, u->t.p_mw * 1e-3, u->t_rx - u->t_sent);
+      p_mw += u->t.p_mw;
+      n_ok++;
+    } else {
+      fprintf(log, "%.0f,%s,%s,,,,,,,,,\n", t, u->name,
+              u->fd < 0 ? "closed" : u->booting ? "boot" : "timeout");
+    }
+    unit_events(u, t);
+  }
+  fprintf(log, "%.0f,total,%d/%d,,,,,,,,%.3f,\n", t, n_ok, n_units, p_mw * 1e-3);
+}
+
+////////////////////////////////////////////////////////////////////////
+// main() function
+////////////////////////////////////////////////////////////////////////
+int main(int argc, char **argv) {
+  double period = 1000, timeout = -1, t_round;
+  long baud = 115200, rounds = 0;
+  const char *log_path = 0;
+  FILE *log = stdout;
+  speed_t speed;
+  time_t start;
+  char *eq, stamp[32];
+
+  // Parse Options
+  for (int k = 1; k < argc; k++) {
+    if (!strcmp(argv[k], "--period") && k + 1 < argc) period = atof(argv[++k]);
+    else if (!strcmp(argv[k], "--timeout") && k + 1 < argc) timeout = atof(argv[++k]);
+    else if (!strcmp(argv[k], "--rounds") && k + 1 < argc) rounds = atol(argv[++k]);
+    else if (!strcmp(argv[k], "--baud") && k + 1 < argc) baud = atol(argv[++k]);
+    else if (!strcmp(argv[k], "--log") && k + 1 < argc) log_path = argv[++k];
+    else if (!strcmp(argv[k], "--boot") && k + 1 < argc) boot_ms = atof(argv[++k]);
+    else if (argv[k][0] != '-' && n_units < FLEET_MAX) {
+      UNIT *u = &units[n_units++];
+      // NAME=PORT, or the port name alone
+      if ((eq = strchr(argv[k], '='))) {
+        *eq = 0;
+        u->name = argv[k];
+        u->port = eq + 1;
+      } else {
+        u->port = argv[k];
+        u->name = strrchr(argv[k], '/') ? strrchr(argv[k], '/') + 1 : argv[k];
+      }
+      u->fd = -1;
+    } else {
+      n_units = 0;
+      break;
+    }
+  }
+  if (n_units == 0) {
+    fprintf(stderr, "usage: %s [--period MS] [--timeout MS] [--rounds N] [--baud B] [--boot MS] [--log FILE] "
+            "[NAME=]PORT ...\n", argv[0]);
+    return 2;
+  }
+  if (!(speed = baud_speed(baud))) {
+    fprintf(stderr, "unsupported baud %ld\n", baud);
+    return 2;
+  }
+  if (timeout < 0) timeout = period / 2;
+  if (log_path && !(log = fopen(log_path, "w"))) {
+    perror(log_path);
+    return 1;
+  }
+  // Rows as they come (tail -f)
+  setvbuf(log, 0, _IOLBF, 0);
+
+  // Header, with the wall clock at t_ms = 0
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  start = time(0);
+  strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", localtime(&start));
+  fprintf(log, "# start %s\n", stamp);
+  fprintf(log, "t_ms,unit,status,uptime_ms,t_board_ms,state,fault,duty,v_solar,v_battery,p_w,rtt_ms\n");
+
+  // Poll Rounds
+  for (long r = 0; rounds == 0 || r < rounds; r++) {
+    t_round = r * period;
+    while (now_ms() < t_round) usleep((useconds_t) ((t_round - now_ms()) * 1e3) + 1);
+    poll_round(speed, timeout);
+    log_round(log, t_round);
+  }
+  for (int k = 0; k < n_units; k++) unit_close(&units[k]);
+  if (log != stdout) fclose(log);
+  return 0;
+}
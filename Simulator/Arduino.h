@@ -0,0 +1,129 @@
+////////////////////////////////////////////////////////////////////////
+// Arduino.h
+// Arduino Core Shim Header File (host simulator)
+// by: Aistheta Gleason
+////////////////////////////////////////////////////////////////////////
+// Safety Note: Read the README!!! Keep Battery in well ventilated area
+////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////
+// Copyright and License
+////////////////////////////////////////////////////////////////////////
+// Copyright 2022, Aistheta (Adam) Gleason
+////////////////////////////////////////////////////////////////////////
+// This program is free software: you can redistribute it and/or modify 
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or 
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// (LICENSE) along with this program. If not, see 
+// https://www.gnu.org/licenses/
+
+////////////////////////////////////////////////////////////////////////
+// Just enough of the Arduino core for the firmware to build on the
+// host. Time is virtual: analogRead(), digitalWrite() etc. advance it
+// by what they cost on the AVR, and the Timer1 interrupt fires when
+// virtual time crosses a tick (see arduino.cpp and sim.h).
+////////////////////////////////////////////////////////////////////////
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+////////////////////////////////////////////////////////////////////////
+// Constants
+////////////////////////////////////////////////////////////////////////
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define DEC 10
+#define HEX 16
+// Program Memory is ordinary memory on the host
+#define PROGMEM
+#define PSTR(S) (S)
+#define F(S) (reinterpret_cast<const __FlashStringHelper *>(S))
+#define memcpy_P memcpy
+#define strcmp_P strcmp
+// Analog Pins (UNO/Pro Mini numbering)
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+
+////////////////////////////////////////////////////////////////////////
+// Type Definitions
+////////////////////////////////////////////////////////////////////////
+typedef uint8_t byte;
+typedef bool boolean;
+// Flash String Marker (F() strings)
+class __FlashStringHelper;
+
+////////////////////////////////////////////////////////////////////////
+// Serial Class
+////////////////////////////////////////////////////////////////////////
+class HardwareSerial {
+  public:
+    void begin(unsigned long baud);
+    int available();
+    int read();
+    size_t write(uint8_t c);
+    size_t print(const char *s);
+    size_t print(const __FlashStringHelper *s);
+    size_t print(char c);
+    size_t print(unsigned char n, int base = DEC);
+    size_t print(int n, int base = DEC);
+    size_t print(unsigned int n, int base = DEC);
+    size_t print(long n, int base = DEC);
+    size_t print(unsigned long n, int base = DEC);
+    size_t print(double n, int digits = 2);
+    size_t println();
+    template <typename T> size_t println(T n) {
+      size_t len = print(n);
+      return len + println();
+    }
+    template <typename T> size_t println(T n, int fmt) {
+      size_t len = print(n, fmt);
+      return len + println();
+    }
+};
+extern HardwareSerial Serial;
+
+////////////////////////////////////////////////////////////////////////
+// Function Prototypes
+////////////////////////////////////////////////////////////////////////
+// Time
+extern unsigned long millis();
+extern unsigned long micros();
+extern void delay(unsigned long ms);
+extern void delayMicroseconds(unsigned int us);
+// GPIO and ADC
+extern void pinMode(uint8_t pin, uint8_t mode);
+extern void digitalWrite(uint8_t pin, uint8_t val);
+extern int digitalRead(uint8_t pin);
+extern int analogRead(uint8_t pin);
+// Non-blocking Conversion, what ADMUX/ADSC and ADC do on the AVR
+extern void sim_adc_start(uint8_t pin);
+extern bool sim_adc_busy();
+extern int sim_adc_result();
+// Interrupts
+extern void noInterrupts();
+extern void interrupts();
+
+#endif
@@ -0,0 +1,62 @@
+////////////////////////////////////////////////////////////////////////
+// EEPROM.h
+// EEPROM Library Shim Header File (host simulator)
+// by: Aistheta Gleason
+////////////////////////////////////////////////////////////////////////
+// Safety Note: Read the README!!! Keep Battery in well ventilated area
+////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////
+// Copyright and License
+////////////////////////////////////////////////////////////////////////
+// Copyright 2022, Aistheta (Adam) Gleason
+////////////////////////////////////////////////////////////////////////
+// This program is free software: you can redistribute it and/or modify 
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or 
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// (LICENSE) along with this program. If not, see 
+// https://www.gnu.org/licenses/
+
+#ifndef EEPROM_H
+#define EEPROM_H
+
+////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////
+#include <stdint.h>
+#include <string.h>
+
+////////////////////////////////////////////////////////////////////////
+// Constants
+////////////////////////////////////////////////////////////////////////
+// ATmega328P EEPROM Size (bytes)
+#define EEPROM_SIZE 1024
+
+////////////////////////////////////////////////////////////////////////
+// EEPROM Class, erased (0xFF) at start of every run
+////////////////////////////////////////////////////////////////////////
+class EEPROMClass {
+  public:
+    uint8_t data[EEPROM_SIZE];
+    EEPROMClass() { memset(data, 0xFF, sizeof(data)); }
+    uint8_t read(int addr) { return data[addr]; }
+    void write(int addr, uint8_t val) { data[addr] = val; }
+    void update(int addr, uint8_t val) { data[addr] = val; }
+    template <typename T> T &get(int addr, T &t) {
+      memcpy((void *) &t, &data[addr], sizeof(T));
+      return t;
+    }
+    template <typename T> const T &put(int addr, const T &t) {
+      memcpy(&data[addr], (const void *) &t, sizeof(T));
+      return t;
+    }
+};
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,41 @@
+////////////////////////////////////////////////////////////////////////
+// TimerOne.h
+// Timer1 Library Shim Header File (host simulator)
+// by: Aistheta Gleason
+////////////////////////////////////////////////////////////////////////
+// Safety Note: Read the README!!! Keep Battery in well ventilated area
+////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////
+// Copyright and License
+////////////////////////////////////////////////////////////////////////
+// Copyright 2022, Aistheta (Adam) Gleason
+////////////////////////////////////////////////////////////////////////
+// This program is free software: you can redistribute it and/or modify 
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or 
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// (LICENSE) along with this program. If not, see 
+// https://www.gnu.org/licenses/
+
+#ifndef TIMERONE_H
+#define TIMERONE_H
+
+////////////////////////////////////////////////////////////////////////
+// Timer1 Class, ticks run off the simulator's virtual clock
+////////////////////////////////////////////////////////////////////////
+class TimerOne {
+  public:
+    void initialize(unsigned long period_us);
+    void setPeriod(unsigned long period_us);
+    void attachInterrupt(void (*isr)());
+    void detachInterrupt();
+};
+extern TimerOne Timer1;
+
+#endif
@@ -0,0 +1,311 @@
+////////////////////////////////////////////////////////////////////////
+// arduino.cpp
+// Arduino Core Shim Source File (host simulator)
+// by: Aistheta Gleason
+////////////////////////////////////////////////////////////////////////
+// Safety Note: Read the README!!! Keep Battery in well ventilated area
+////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////
+// Copyright and License
+////////////////////////////////////////////////////////////////////////
+// Copyright 2022, Aistheta (Adam) Gleason
+////////////////////////////////////////////////////////////////////////
+// This program is free software: you can redistribute it and/or modify 
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or 
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// (LICENSE) along with this program. If not, see 
+// https://www.gnu.org/licenses/
+
+////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////
+#include "Arduino.h"
+#include "TimerOne.h"
+#include "EEPROM.h"
+// Simulator Core
+#include "sim.h"
+// Plant
+#include "plant.h"
+// Firmware Config (SW1 pin and ADC coefficient)
+#include "config.h"
+#include <unistd.h>
+
+////////////////////////////////////////////////////////////////////////
+// Global Variables
+////////////////////////////////////////////////////////////////////////
+// Virtual Time (us)
+unsigned long long sim_us;
+// Serial File Descriptors (-1 = not connected)
+int sim_serial_in = -1, sim_serial_out = -1;
+// SW1 Pin Level
+int sim_sw1;
+// Time SW1 was last driven low (us)
+unsigned long long sim_sw1_low_us;
+// ADC pin frozen at its last code (-1 = none), fault injection
+int sim_adc_stuck = -1;
+// ADC Noise (std dev in codes, 0 = none)
+double sim_adc_noise;
+// Shim Objects
+HardwareSerial Serial;
+TimerOne Timer1;
+EEPROMClass EEPROM;
+// Timer State
+static void (*timer_isr)() = 0;
+static unsigned long timer_period;
+static unsigned long long timer_next;
+// Interrupt State
+static bool irq_enabled = 1, in_isr = 0;
+// Serial Peek Byte (-1 = none buffered)
+static int serial_peek = -1;
+// Last Code per Analog Pin
+static int adc_last[8];
+// Conversion started by sim_adc_start(): its Code, when it's done (us)
+// and whether it hasn't been read back yet
+static int adc_code;
+static unsigned long long adc_done;
+static bool adc_pend = 0;
+
+////////////////////////////////////////////////////////////////////////
+// Simulator Core
+////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////
+// sim_advance() function
+// Moves virtual time forward by us, pre-empting with any timer ticks
+// that fall due (the ISR's own cost pushes the caller's work back)
+////////////////////////////////////////////////////////////////////////
+void sim_advance(unsigned long us) {
+  unsigned long long remaining = us;
+  while (timer_isr && timer_period && irq_enabled && !in_isr &&
+         timer_next <= sim_us + remaining) {
+    // Run up to the tick (late ticks fire straight away)
+    if (timer_next > sim_us) {
+      remaining -= timer_next - sim_us;
+      sim_us = timer_next;
+    }
+    plant_step_to(sim_us);
+    timer_next += timer_period;
+    in_isr = 1;
+    timer_isr();
+    in_isr = 0;
+  }
+  sim_us += remaining;
+  plant_step_to(sim_us);
+}
+
+////////////////////////////////////////////////////////////////////////
+// Time
+////////////////////////////////////////////////////////////////////////
+unsigned long millis() {
+  sim_advance(1);
+  return sim_us / 1000;
+}
+
+unsigned long micros() {
+  sim_advance(1);
+  return sim_us;
+}
+
+void delay(unsigned long ms) {
+  sim_advance(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  sim_advance(us);
+}
+
+////////////////////////////////////////////////////////////////////////
+// GPIO and ADC
+////////////////////////////////////////////////////////////////////////
+void pinMode(uint8_t pin, uint8_t mode) {
+  (void) pin;
+  (void) mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  sim_advance(SIM_GPIO_US);
+  if (pin == SW1_PWM) {
+    sim_sw1 = val;
+    plant.sw = val;
+    if (!val) sim_sw1_low_us = sim_us;
+  }
+}
+
+int digitalRead(uint8_t pin) {
+  return (pin == SW1_PWM) ? sim_sw1 : LOW;
+}
+
+// Unit Gaussian (Box-Muller), fixed seed so runs repeat
+static double adc_gauss() {
+  static unsigned short seed[3] = {1, 2, 3};
+  double u;
+  if (sim_adc_noise == 0) return 0;
+  do u = erand48(seed); while (u == 0);
+  return sqrt(-2 * log(u)) * cos(2 * M_PI * erand48(seed));
+}
+
+// Code of a conversion on pin started now (sample and hold)
+static int adc_sample(uint8_t pin) {
+  long code;
+  int k = (pin >= A0 ? pin - A0 : pin) & 7;
+  plant_step_to(sim_us);
+  code = lround(plant_pin_voltage(pin) / ADC_COEF + sim_adc_noise * adc_gauss());
+  if (code < 0) code = 0;
+  if (code > 1023) code = 1023;
+  // Stuck pin keeps returning its last code
+  if (pin == sim_adc_stuck) code = adc_last[k];
+  adc_last[k] = code;
+  return code;
+}
+
+int analogRead(uint8_t pin) {
+  int code;
+  // A started conversion still running: like the AVR, ADSC is already
+  // set, so this waits it out and returns its code (the wrong pin)
+  if (adc_pend && sim_us < adc_done) {
+    sim_advance(adc_done - sim_us + SIM_ADC_US - SIM_ADC_CONV_US);
+    adc_pend = 0;
+    return adc_code;
+  }
+  adc_pend = 0;
+  code = adc_sample(pin);
+  sim_advance(SIM_ADC_US);
+  return code;
+}
+
+void sim_adc_start(uint8_t pin) {
+  adc_code = adc_sample(pin);
+  adc_done = sim_us + SIM_ADC_CONV_US;
+  adc_pend = 1;
+  sim_advance(SIM_ADC_REG_US);
+}
+
+bool sim_adc_busy() {
+  // Reading ADCSRA, so a loop polling it moves time on
+  sim_advance(SIM_ADC_REG_US);
+  return adc_pend && sim_us < adc_done;
+}
+
+int sim_adc_result() {
+  adc_pend = 0;
+  sim_advance(SIM_ADC_REG_US);
+  return adc_code;
+}
+
+////////////////////////////////////////////////////////////////////////
+// Interrupts
+////////////////////////////////////////////////////////////////////////
+void noInterrupts() {
+  irq_enabled = 0;
+}
+
+void interrupts() {
+  irq_enabled = 1;
+  // Fire anything that came due while masked
+  sim_advance(0);
+}
+
+////////////////////////////////////////////////////////////////////////
+// Timer1
+////////////////////////////////////////////////////////////////////////
+void TimerOne::initialize(unsigned long period_us) {
+  timer_period = period_us;
+  timer_next = sim_us + period_us;
+}
+
+void TimerOne::setPeriod(unsigned long period_us) {
+  timer_period = period_us;
+  timer_next = sim_us + period_us;
+}
+
+void TimerOne::attachInterrupt(void (*isr)()) {
+  timer_isr = isr;
+}
+
+void TimerOne::detachInterrupt() {
+  timer_isr = 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// Serial
+////////////////////////////////////////////////////////////////////////
+void HardwareSerial::begin(unsigned long baud) {
+  (void) baud;
+}
+
+int HardwareSerial::available() {
+  unsigned char c;
+  sim_advance(1);
+  if (serial_peek < 0 && sim_serial_in >= 0 && ::read(sim_serial_in, &c, 1) == 1) serial_peek = c;
+  return serial_peek >= 0;
+}
+
+int HardwareSerial::read() {
+  int c;
+  if (!available()) return -1;
+  c = serial_peek;
+  serial_peek = -1;
+  return c;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (sim_serial_out >= 0 && ::write(sim_serial_out, &c, 1) != 1) return 0;
+  return 1;
+}
+
+size_t HardwareSerial::print(const char *s) {
+  size_t len = 0;
+  while (*s) len += write(*s++);
+  return len;
+}
+
+size_t HardwareSerial::print(const __FlashStringHelper *s) {
+  return print(reinterpret_cast<const char *>(s));
+}
+
+size_t HardwareSerial::print(char c) {
+  return write(c);
+}
+
+size_t HardwareSerial::print(unsigned char n, int base) {
+  return print((unsigned long) n, base);
+}
+
+size_t HardwareSerial::print(int n, int base) {
+  return print((long) n, base);
+}
+
+size_t HardwareSerial::print(unsigned int n, int base) {
+  return print((unsigned long) n, base);
+}
+
+size_t HardwareSerial::print(long n, int base) {
+  char buf[24];
+  if (base == HEX) snprintf(buf, sizeof(buf), "%lX", n);
+  else snprintf(buf, sizeof(buf), "%ld", n);
+  return print(buf);
+}
+
+size_t HardwareSerial::print(unsigned long n, int base) {
+  char buf[24];
+  if (base == HEX) snprintf(buf, sizeof(buf), "%lX", n);
+  else snprintf(buf, sizeof(buf), "%lu", n);
+  return print(buf);
+}
+
+size_t HardwareSerial::print(double n, int digits) {
+  char buf[48];
+  snprintf(buf, sizeof(buf), "%.*f", digits, n);
+  return print(buf);
+}
+
+size_t HardwareSerial::println() {
+  return print("\r\n");
+}
@@ -0,0 +1,185 @@
+////////////////////////////////////////////////////////////////////////
+// plant.cpp
+// Buck Converter Plant Source File (host simulator)
+// by: Aistheta Gleason
+////////////////////////////////////////////////////////////////////////
+// Safety Note: Read the README!!! Keep Battery in well ventilated area
+////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////
+// Copyright and License
+////////////////////////////////////////////////////////////////////////
+// Copyright 2022, Aistheta (Adam) Gleason
+////////////////////////////////////////////////////////////////////////
+// This program is free software: you can redistribute it and/or modify 
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or 
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// (LICENSE) along with this program. If not, see 
+// https://www.gnu.org/licenses/
+
+////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////
+// Plant Header
+#include "plant.h"
+// Firmware Config (pins and sense chain coefficients)
+#include "config.h"
+#include <math.h>
+
+////////////////////////////////////////////////////////////////////////
+// Global Variables
+////////////////////////////////////////////////////////////////////////
+PLANT plant;
+
+////////////////////////////////////////////////////////////////////////
+// Functions
+////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////
+// plant_default() function
+// 100W 23Voc panel at STC into a 12V lead-acid battery through the
+// nail-wound inductor and solid state relay
+////////////////////////////////////////////////////////////////////////
+void plant_default() {
+  double g[PV_MAX_SUB];
+  pv_default_panel(&plant.panel);
+  plant.l = 5e-3;
+  plant.r_l = 0.2;
+  plant.r_sw = 0.1;
+  plant.c_in = 2200e-6;
+  plant.v_diode = 0.7;
+  plant.v_oc0 = 12.4;
+  plant.dv_ah = 0.012;
+  plant.r_int = 0.05;
+  plant.i_l = 0;
+  plant.q_ah = 0;
+  plant.v_l = 0;
+  plant.v_bat = plant.v_oc0;
+  plant.sw = 0;
+  plant.e_pv = plant.e_mpp = plant.e_bat = 0;
+  plant.i_peak = plant.i_over = 0;
+  plant.t_over_us = 0;
+  plant.t_us = 0;
+  for (unsigned int s = 0; s < PV_MAX_SUB; s++) g[s] = PV_G_STC;
+  plant_conditions(g, PV_T_STC);
+  // Panel starts open circuit
+  plant.v_c = plant.table_dv * (PLANT_TABLE - 1);
+  while (plant.v_c > 0 && plant_pv_current(plant.v_c) < 0) plant.v_c -= 0.01;
+}
+
+////////////////////////////////////////////////////////////////////////
+// plant_conditions() function
+// Tabulates the panel I-V curve from 0 to 1.1*Voc(T) in one batch
+////////////////////////////////////////////////////////////////////////
+void plant_conditions(const double *g, double t) {
+  double v[PLANT_TABLE], tt[PLANT_TABLE], gg[PLANT_TABLE * PV_MAX_SUB];
+  unsigned int n_sub = plant.panel.n_sub;
+  bool shaded = 0;
+  double p;
+  for (unsigned int s = 0; s < n_sub; s++) {
+    plant.g[s] = g[s];
+    if (g[s] != g[0]) shaded = 1;
+  }
+  plant.t = t;
+  plant.table_dv = 1.1 * (plant.panel.voc + plant.panel.beta_voc * (t - PV_T_STC)) / (PLANT_TABLE - 1);
+  for (int k = 0; k < PLANT_TABLE; k++) {
+    v[k] = k * plant.table_dv;
+    tt[k] = t;
+    for (unsigned int s = 0; s < n_sub; s++) gg[k * n_sub + s] = g[s];
+  }
+  // Uniform irradiance needs only the cheaper single string solve
+  if (shaded) pv_current_shaded_batch(&plant.panel, v, gg, tt, plant.table_i, PLANT_TABLE);
+  else pv_current_batch(&plant.panel, v, gg, tt, plant.table_i, PLANT_TABLE);
+  // Maximum Power Point (global, shading can give several local peaks)
+  plant.p_mpp = 0;
+  plant.v_mpp = 0;
+  for (int k = 0; k < PLANT_TABLE; k++) {
+    p = v[k] * plant.table_i[k];
+    if (p > plant.p_mpp) {
+      plant.p_mpp = p;
+      plant.v_mpp = v[k];
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// plant_pv_current() function
+// Linear interpolation in the I-V table, extrapolates off either end
+////////////////////////////////////////////////////////////////////////
+double plant_pv_current(double v) {
+  double x = v / plant.table_dv;
+  int k = (int) floor(x);
+  if (k < 0) k = 0;
+  if (k > PLANT_TABLE - 2) k = PLANT_TABLE - 2;
+  return plant.table_i[k] + (x - k) * (plant.table_i[k + 1] - plant.table_i[k]);
+}
+
+////////////////////////////////////////////////////////////////////////
+// plant_step() function
+// One explicit Euler step of dt seconds
+////////////////////////////////////////////////////////////////////////
+static void plant_step(double dt) {
+  double i_pv, v_oc, di;
+  i_pv = plant_pv_current(plant.v_c);
+  v_oc = plant.v_oc0 + plant.dv_ah * plant.q_ah;
+  if (plant.sw) {
+    // SW1 on: panel cap drives the inductor into the battery
+    di = (plant.v_c - plant.i_l * (plant.r_sw + plant.r_l + plant.r_int) - v_oc) / plant.l;
+    plant.v_c += (i_pv - plant.i_l) * dt / plant.c_in;
+  } else if (plant.i_l > 0) {
+    // SW1 off: inductor freewheels through the power diode
+    di = (-plant.v_diode - plant.i_l * (plant.r_l + plant.r_int) - v_oc) / plant.l;
+    plant.v_c += i_pv * dt / plant.c_in;
+  } else {
+    // SW1 off and inductor empty (DCM), nothing flows
+    di = 0;
+    plant.v_c += i_pv * dt / plant.c_in;
+  }
+  if (plant.v_c < 0) plant.v_c = 0;
+  // Sensed inductor voltage includes its winding resistance
+  plant.v_l = plant.l * di + plant.i_l * plant.r_l;
+  plant.i_l += di * dt;
+  // Diode blocks reverse current
+  if (plant.i_l < 0) plant.i_l = 0;
+  // Overcurrent Tracking
+  if (plant.i_l > plant.i_peak) plant.i_peak = plant.i_l;
+  if (plant.i_over > 0 && !plant.t_over_us && plant.i_l > plant.i_over) plant.t_over_us = plant.t_us;
+  plant.v_bat = v_oc + plant.i_l * plant.r_int;
+  plant.q_ah += plant.i_l * dt / 3600.0;
+  // Energy Accounting
+  plant.e_pv += plant.v_c * i_pv * dt;
+  plant.e_mpp += plant.p_mpp * dt;
+  plant.e_bat += plant.v_bat * plant.i_l * dt;
+}
+
+////////////////////////////////////////////////////////////////////////
+// plant_step_to() function
+// Steps in PLANT_DT_US increments up to t_us (last step may be short)
+////////////////////////////////////////////////////////////////////////
+void plant_step_to(unsigned long long t_us) {
+  unsigned long long dt;
+  while (plant.t_us < t_us) {
+    dt = t_us - plant.t_us;
+    if (dt > PLANT_DT_US) dt = PLANT_DT_US;
+    plant_step(dt * 1e-6);
+    plant.t_us += dt;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// plant_pin_voltage() function
+// ADC pin voltage through the sense chain, a perfectly calibrated
+// board (inverse of the VBAT/VL/VSOL_MEAS conversions)
+////////////////////////////////////////////////////////////////////////
+double plant_pin_voltage(int pin) {
+  if (pin == VBAT_ADC) return plant.v_bat * ADC_COEF / VBAT_COEF;
+  if (pin == VSOL_ADC) return plant.v_c * ADC_COEF / VSOL_COEF;
+  if (pin == VL_ADC) return plant.v_l / VL_COEF - VL_OFF;
+  return 0;
+}
@@ -0,0 +1,99 @@
+////////////////////////////////////////////////////////////////////////
+// plant.h
+// Buck Converter Plant Header File (host simulator)
+// by: Aistheta Gleason
+////////////////////////////////////////////////////////////////////////
+// Safety Note: Read the README!!! Keep Battery in well ventilated area
+////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////
+// Copyright and License
+////////////////////////////////////////////////////////////////////////
+// Copyright 2022, Aistheta (Adam) Gleason
+////////////////////////////////////////////////////////////////////////
+// This program is free software: you can redistribute it and/or modify 
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or 
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// (LICENSE) along with this program. If not, see 
+// https://www.gnu.org/licenses/
+
+////////////////////////////////////////////////////////////////////////
+// Switching model of the charger power stage, stepped in virtual time:
+// PV panel (table from the SIMD single-diode solver) -> input cap ->
+// SW1 -> inductor -> battery, with the power diode freewheeling when
+// SW1 is off and the inductor current clamped at 0 (DCM).
+////////////////////////////////////////////////////////////////////////
+#ifndef PLANT_H
+#define PLANT_H
+
+////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////
+#include "pv_model.h"
+
+////////////////////////////////////////////////////////////////////////
+// Constants
+////////////////////////////////////////////////////////////////////////
+// Plant Integration Step (us)
+#define PLANT_DT_US 5
+// Points in the Panel I-V Table
+#define PLANT_TABLE 512
+
+////////////////////////////////////////////////////////////////////////
+// Type Definitions
+////////////////////////////////////////////////////////////////////////
+typedef struct _plant {
+  // Panel and Conditions (substring irradiance W/m^2, cell temp C)
+  PV_PANEL panel;
+  double g[PV_MAX_SUB], t;
+  // Converter: inductance (H), winding and switch resistance (ohm),
+  // input capacitance (F), power diode drop (V)
+  double l, r_l, r_sw, c_in, v_diode;
+  // Battery: open circuit voltage (V) at start, rise per Ah charged,
+  // internal resistance (ohm)
+  double v_oc0, dv_ah, r_int;
+  // State: input cap voltage, inductor current, charge in (Ah)
+  double v_c, i_l, q_ah;
+  // Inductor voltage (as sensed, L*di/dt + i*R_L) and battery voltage
+  double v_l, v_bat;
+  // SW1 State
+  bool sw;
+  // Panel I-V Table (uniform in V) and its maximum power point
+  double table_i[PLANT_TABLE], table_dv, v_mpp, p_mpp;
+  // Energy (J): from panel, available at MPP, into battery
+  double e_pv, e_mpp, e_bat;
+  // Peak inductor current (A), and when it first passed i_over (us,
+  // 0 = not yet or i_over unset)
+  double i_peak, i_over;
+  unsigned long long t_over_us;
+  // Plant Time (us)
+  unsigned long long t_us;
+} PLANT;
+
+////////////////////////////////////////////////////////////////////////
+// Global Variables
+////////////////////////////////////////////////////////////////////////
+extern PLANT plant;
+
+////////////////////////////////////////////////////////////////////////
+// Function Prototypes
+////////////////////////////////////////////////////////////////////////
+// Load default parameters (100W panel, 12V lead-acid battery)
+extern void plant_default();
+// Set irradiance per substring (n_sub values) and temperature,
+// rebuilds the I-V table with the batch solver
+extern void plant_conditions(const double *g, double t);
+// Panel current at a voltage (table lookup)
+extern double plant_pv_current(double v);
+// Step the plant up to time t_us
+extern void plant_step_to(unsigned long long t_us);
+// Voltage on an ADC pin (V) for the firmware's sense chain
+extern double plant_pin_voltage(int pin);
+
+#endif
@@ -0,0 +1,409 @@
+////////////////////////////////////////////////////////////////////////
+// pv_model.cpp
+// PV Panel Model Source File (host simulator)
+// by: Aistheta Gleason
+////////////////////////////////////////////////////////////////////////
+// Safety Note: Read the README!!! Keep Battery in well ventilated area
+////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////
+// Copyright and License
+////////////////////////////////////////////////////////////////////////
+// Copyright 2022, Aistheta (Adam) Gleason
+////////////////////////////////////////////////////////////////////////
+// This program is free software: you can redistribute it and/or modify 
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or 
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// (LICENSE) along with this program. If not, see 
+// https://www.gnu.org/licenses/
+
+////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////
+// PV Model Header
+#include "pv_model.h"
+#include <math.h>
+#include <string.h>
+
+////////////////////////////////////////////////////////////////////////
+// Constants
+////////////////////////////////////////////////////////////////////////
+// Boltzmann Constant over Electron Charge (V/K)
+#define PV_K_Q (1.380649e-23 / 1.602176634e-19)
+// Kelvin Offset
+#define PV_KELVIN 273.15
+// Newton Iteration Limit and Tolerance (A)
+#define PV_ITER 60
+#define PV_TOL 1e-9
+// Reference Solver Bisection Limit and Bracket Width (V or A)
+#define PV_REF_ITER 200
+#define PV_REF_TOL 1e-13
+// ln(2) split for exp range reduction
+#define LN2_HI 6.93147180369123816490e-01
+#define LN2_LO 1.90821492927058770002e-10
+
+////////////////////////////////////////////////////////////////////////
+// Vector Types
+////////////////////////////////////////////////////////////////////////
+// 4 doubles per vector, the compiler maps it onto AVX (one register),
+// SSE2/NEON (two registers) or scalar code depending on -march
+#define PV_LANES 4
+typedef double vd __attribute__((vector_size(PV_LANES * sizeof(double))));
+typedef long long vl __attribute__((vector_size(PV_LANES * sizeof(long long))));
+// Broadcast a scalar to every lane
+#define VSPLAT(S) (vd{} + (double) (S))
+
+////////////////////////////////////////////////////////////////////////
+// Functions
+////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////
+// any_lane() function
+// True if any lane of a comparison mask is set
+////////////////////////////////////////////////////////////////////////
+static inline bool any_lane(vl m) {
+  for (int k = 0; k < PV_LANES; k++) {
+    if (m[k]) return 1;
+  }
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// vexp() function
+// Vector exp, range reduced to |r| <= ln(2)/2 then degree 11 Taylor,
+// accurate to a few ulp over the clamped range [-708, 708]
+////////////////////////////////////////////////////////////////////////
+static inline vd vexp(vd x) {
+  vd kd, r, p, scale;
+  vl k, bits;
+  // Clamp to the range a double can hold
+  x = (x > 708.0) ? VSPLAT(708.0) : x;
+  x = (x < -708.0) ? VSPLAT(-708.0) : x;
+  // x = k*ln(2) + r
+  kd = x * M_LOG2E;
+  kd += (kd >= 0.0) ? VSPLAT(0.5) : VSPLAT(-0.5);
+  k = __builtin_convertvector(kd, vl);
+  kd = __builtin_convertvector(k, vd);
+  r = x - kd * LN2_HI - kd * LN2_LO;
+  // exp(r), Horner
+  p = VSPLAT(1.0 / 39916800.0);
+  p = p * r + 1.0 / 3628800.0;
+  p = p * r + 1.0 / 362880.0;
+  p = p * r + 1.0 / 40320.0;
+  p = p * r + 1.0 / 5040.0;
+  p = p * r + 1.0 / 720.0;
+  p = p * r + 1.0 / 120.0;
+  p = p * r + 1.0 / 24.0;
+  p = p * r + 1.0 / 6.0;
+  p = p * r + 0.5;
+  p = p * r + 1.0;
+  p = p * r + 1.0;
+  // 2^k straight into the exponent bits
+  bits = (k + 1023) << 52;
+  memcpy(&scale, &bits, sizeof(scale));
+  return p * scale;
+}
+
+////////////////////////////////////////////////////////////////////////
+// vlog() function
+// Vector natural log for x > 0, mantissa reduced to [sqrt(1/2), sqrt(2))
+// then 2*atanh(s) series with s = (m-1)/(m+1), |s| <= 0.172
+////////////////////////////////////////////////////////////////////////
+static inline vd vlog(vd x) {
+  vl bits, e;
+  vd m, s, s2, p;
+  memcpy(&bits, &x, sizeof(bits));
+  // Split exponent and mantissa in [1, 2)
+  e = ((bits >> 52) & 0x7FF) - 1023;
+  bits = (bits & 0x000FFFFFFFFFFFFFLL) | 0x3FF0000000000000LL;
+  memcpy(&m, &bits, sizeof(m));
+  // Move mantissa to [sqrt(1/2), sqrt(2)) (true mask lanes are -1)
+  e -= (m > M_SQRT2);
+  m = (m > M_SQRT2) ? m * 0.5 : m;
+  s = (m - 1.0) / (m + 1.0);
+  s2 = s * s;
+  p = VSPLAT(1.0 / 15.0);
+  p = p * s2 + 1.0 / 13.0;
+  p = p * s2 + 1.0 / 11.0;
+  p = p * s2 + 1.0 / 9.0;
+  p = p * s2 + 1.0 / 7.0;
+  p = p * s2 + 1.0 / 5.0;
+  p = p * s2 + 1.0 / 3.0;
+  p = p * s2 + 1.0;
+  return __builtin_convertvector(e, vd) * M_LN2 + 2.0 * s * p;
+}
+
+////////////////////////////////////////////////////////////////////////
+// load_lanes() function
+// Loads up to PV_LANES values (stride apart), padding with the last one
+////////////////////////////////////////////////////////////////////////
+static inline vd load_lanes(const double *src, size_t n, size_t stride) {
+  vd x;
+  for (size_t k = 0; k < PV_LANES; k++) x[k] = src[((k < n) ? k : n - 1) * stride];
+  return x;
+}
+
+////////////////////////////////////////////////////////////////////////
+// diode_lanes() function
+// Photo current, saturation current and a = n*Ns*k*T/q for a string of
+// cells at irradiance g (W/m^2) and temperature t (C)
+////////////////////////////////////////////////////////////////////////
+static inline void diode_lanes(const PV_PANEL *panel, unsigned int cells,
+                               vd g, vd t, vd *iph, vd *i0, vd *a) {
+  vd isc_t, voc_t;
+  *a = panel->n * cells * PV_K_Q * (t + PV_KELVIN);
+  isc_t = panel->isc + panel->alpha_isc * (t - PV_T_STC);
+  voc_t = (panel->voc + panel->beta_voc * (t - PV_T_STC)) * cells / panel->n_cells;
+  *iph = isc_t * g / PV_G_STC;
+  *i0 = isc_t / (vexp(voc_t / *a) - 1.0);
+}
+
+////////////////////////////////////////////////////////////////////////
+// solve_uniform() function
+// Newton on I for a vector of panel voltages, f(I) is concave and
+// decreasing so from the clamped explicit (Rs = 0) guess it converges
+// monotonically after at most one overshoot
+////////////////////////////////////////////////////////////////////////
+static vd solve_uniform(const PV_PANEL *panel, vd v, vd iph, vd i0, vd a) {
+  vd i, vdiode, e, f, df, step;
+  // Explicit guess with Rs = 0, clamped to [-Iph, Iph]
+  i = iph - i0 * (vexp(v / a) - 1.0) - v / panel->rsh;
+  i = (i > iph) ? iph : i;
+  i = (i < -iph) ? -iph : i;
+  for (int it = 0; it < PV_ITER; it++) {
+    vdiode = v + i * panel->rs;
+    e = vexp(vdiode / a);
+    f = iph - i0 * (e - 1.0) - vdiode / panel->rsh - i;
+    df = -i0 * panel->rs / a * e - panel->rs / panel->rsh - 1.0;
+    step = f / df;
+    i -= step;
+    if (!any_lane((step > PV_TOL) | (step < -PV_TOL))) break;
+  }
+  return i;
+}
+
+////////////////////////////////////////////////////////////////////////
+// substring_guess() function
+// Explicit diode voltage guess for a substring carrying current i,
+// forward a*ln(x/I0 + 1) (Rsh = inf), reverse straight through Rsh
+////////////////////////////////////////////////////////////////////////
+static inline vd substring_guess(vd i, vd iph, vd i0, vd a, double rsh) {
+  vd x = iph - i;
+  return (x > 0.0) ? a * vlog(x / i0 + 1.0) : x * rsh;
+}
+
+////////////////////////////////////////////////////////////////////////
+// substring_voltage() function
+// Voltage of one bypassed substring carrying current i, also returns
+// dV/dI. Newton on the diode voltage from the explicit guess, which is
+// right of the root in the forward region so it converges monotonically.
+////////////////////////////////////////////////////////////////////////
+static inline vd substring_voltage(vd i, vd iph, vd i0, vd a, double rs,
+                                   double rsh, double v_bypass, vd *dv) {
+  vd x, vdiode, e, f, df, step, v;
+  vl clamped;
+  x = iph - i;
+  vdiode = substring_guess(i, iph, i0, a, rsh);
+  for (int it = 0; it < PV_ITER; it++) {
+    e = vexp(vdiode / a);
+    f = x - i0 * (e - 1.0) - vdiode / rsh;
+    df = -i0 / a * e - 1.0 / rsh;
+    step = f / df;
+    vdiode -= step;
+    if (!any_lane((step > PV_TOL) | (step < -PV_TOL))) break;
+  }
+  v = vdiode - i * rs;
+  // Bypass diode clamps the reverse voltage (flat, so dV/dI = 0)
+  clamped = v < -v_bypass;
+  *dv = clamped ? VSPLAT(0.0) : -(rs + 1.0 / (i0 / a * e + 1.0 / rsh));
+  return clamped ? VSPLAT(-v_bypass) : v;
+}
+
+////////////////////////////////////////////////////////////////////////
+// pv_default_panel() function
+// 100W 23Voc panel the charger was built for
+////////////////////////////////////////////////////////////////////////
+void pv_default_panel(PV_PANEL *panel) {
+  panel->isc = 5.8;
+  panel->voc = 23.0;
+  panel->n = 1.3;
+  panel->n_cells = 36;
+  panel->n_sub = 3;
+  panel->rs = 0.35;
+  panel->rsh = 300.0;
+  panel->alpha_isc = 0.003;
+  panel->beta_voc = -0.08;
+  panel->v_bypass = 0.6;
+}
+
+////////////////////////////////////////////////////////////////////////
+// pv_current() function
+// Scalar reference solver (plain Newton, no SIMD)
+////////////////////////////////////////////////////////////////////////
+double pv_current(const PV_PANEL *panel, double v, double g, double t) {
+  double a, isc_t, voc_t, iph, i0, i, vdiode, e, f, df, step;
+  a = panel->n * panel->n_cells * PV_K_Q * (t + PV_KELVIN);
+  isc_t = panel->isc + panel->alpha_isc * (t - PV_T_STC);
+  voc_t = panel->voc + panel->beta_voc * (t - PV_T_STC);
+  iph = isc_t * g / PV_G_STC;
+  i0 = isc_t / (exp(voc_t / a) - 1.0);
+  i = iph - i0 * (exp(fmin(v / a, 708.0)) - 1.0) - v / panel->rsh;
+  i = fmax(fmin(i, iph), -iph);
+  for (int it = 0; it < PV_ITER; it++) {
+    vdiode = v + i * panel->rs;
+    e = exp(fmin(vdiode / a, 708.0));
+    f = iph - i0 * (e - 1.0) - vdiode / panel->rsh - i;
+    df = -i0 * panel->rs / a * e - panel->rs / panel->rsh - 1.0;
+    step = f / df;
+    i -= step;
+    if (fabs(step) <= PV_TOL) break;
+  }
+  return i;
+}
+
+////////////////////////////////////////////////////////////////////////
+// substring_ref() function
+// Scalar reference voltage of one bypassed substring carrying current
+// i. The diode voltage is bracketed by doubling, then bisected down to
+// PV_REF_TOL (no Newton, so it shares nothing with substring_voltage()).
+////////////////////////////////////////////////////////////////////////
+static double substring_ref(double i, double iph, double i0, double a, double rs,
+                            double rsh, double v_bypass) {
+  double lo = -1.0, hi = 1.0, mid;
+  // f(Vd) = Iph - i - I0*(exp(Vd/a) - 1) - Vd/Rsh, decreasing in Vd
+#define SUB_F(VD) (iph - i - i0 * (exp(fmin((VD) / a, 708.0)) - 1.0) - (VD) / rsh)
+  while (SUB_F(lo) < 0) lo *= 2;
+  while (SUB_F(hi) > 0) hi *= 2;
+  for (int it = 0; it < PV_REF_ITER && hi - lo >= PV_REF_TOL; it++) {
+    mid = (lo + hi) / 2;
+    if (SUB_F(mid) > 0) lo = mid;
+    else hi = mid;
+  }
+#undef SUB_F
+  return fmax((lo + hi) / 2 - i * rs, -v_bypass);
+}
+
+////////////////////////////////////////////////////////////////////////
+// pv_current_shaded() function
+// Scalar reference for a shaded panel, bisects the string current until
+// the substring voltages add up to v. Needs v > -n_sub*v_bypass (below
+// that the bypass diodes would carry any current).
+////////////////////////////////////////////////////////////////////////
+double pv_current_shaded(const PV_PANEL *panel, double v, const double *g, double t) {
+  unsigned int n_sub = panel->n_sub, cells;
+  double a, isc_t, voc_t, iph[PV_MAX_SUB], i0[PV_MAX_SUB], rs, rsh, lo, hi, mid, h;
+  if (n_sub == 0 || n_sub > PV_MAX_SUB) return NAN;
+  cells = panel->n_cells / n_sub;
+  rs = panel->rs / n_sub;
+  rsh = panel->rsh / n_sub;
+  a = panel->n * cells * PV_K_Q * (t + PV_KELVIN);
+  isc_t = panel->isc + panel->alpha_isc * (t - PV_T_STC);
+  voc_t = (panel->voc + panel->beta_voc * (t - PV_T_STC)) * cells / panel->n_cells;
+  hi = 1.0;
+  for (unsigned int s = 0; s < n_sub; s++) {
+    iph[s] = isc_t * g[s] / PV_G_STC;
+    i0[s] = isc_t / (exp(voc_t / a) - 1.0);
+    if (iph[s] + 1.0 > hi) hi = iph[s] + 1.0;
+  }
+  // Sum of substring voltages less v, decreasing in the current. Above
+  // the brightest Iph every substring is bypassed, so hi is past the root.
+  lo = -1.0;
+  for (;;) {
+    h = -v;
+    for (unsigned int s = 0; s < n_sub; s++) h += substring_ref(lo, iph[s], i0[s], a, rs, rsh, panel->v_bypass);
+    if (h >= 0) break;
+    lo *= 2;
+  }
+  for (int it = 0; it < PV_REF_ITER && hi - lo >= PV_REF_TOL; it++) {
+    mid = (lo + hi) / 2;
+    h = -v;
+    for (unsigned int s = 0; s < n_sub; s++) h += substring_ref(mid, iph[s], i0[s], a, rs, rsh, panel->v_bypass);
+    if (h > 0) lo = mid;
+    else hi = mid;
+  }
+  return (lo + hi) / 2;
+}
+
+////////////////////////////////////////////////////////////////////////
+// pv_current_batch() function
+// Uniform irradiance batch, PV_LANES points per vector
+////////////////////////////////////////////////////////////////////////
+void pv_current_batch(const PV_PANEL *panel, const double *v,
+                      const double *g, const double *t,
+                      double *i, size_t n) {
+  vd iph, i0, a, out;
+  size_t m;
+  for (size_t k = 0; k < n; k += PV_LANES) {
+    m = (n - k < PV_LANES) ? n - k : PV_LANES;
+    diode_lanes(panel, panel->n_cells, load_lanes(g + k, m, 1),
+                load_lanes(t + k, m, 1), &iph, &i0, &a);
+    out = solve_uniform(panel, load_lanes(v + k, m, 1), iph, i0, a);
+    for (size_t j = 0; j < m; j++) i[k + j] = out[j];
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// pv_current_shaded_batch() function
+// Shaded batch, series substrings with bypass diodes. Solves
+// sum(V_s(I)) = V for I with bracketed Newton (bisects whenever the
+// Newton step leaves the bracket or every substring is bypassed)
+////////////////////////////////////////////////////////////////////////
+bool pv_current_shaded_batch(const PV_PANEL *panel, const double *v,
+                             const double *g, const double *t,
+                             double *i, size_t n) {
+  unsigned int n_sub = panel->n_sub, cells;
+  double rs, rsh;
+  vd iph[PV_MAX_SUB], i0[PV_MAX_SUB], a[PV_MAX_SUB];
+  vd vv, tt, lo, hi, cur, h, dh, vs, dvs, next, iph_max;
+  vl open;
+  size_t m;
+  // Per substring state is sized for PV_MAX_SUB
+  if (n_sub == 0 || n_sub > PV_MAX_SUB) return 0;
+  cells = panel->n_cells / n_sub;
+  rs = panel->rs / n_sub;
+  rsh = panel->rsh / n_sub;
+  for (size_t k = 0; k < n; k += PV_LANES) {
+    m = (n - k < PV_LANES) ? n - k : PV_LANES;
+    vv = load_lanes(v + k, m, 1);
+    tt = load_lanes(t + k, m, 1);
+    iph_max = VSPLAT(0.0);
+    for (unsigned int s = 0; s < n_sub; s++) {
+      diode_lanes(panel, cells, load_lanes(g + k * n_sub + s, m, n_sub), tt,
+                  &iph[s], &i0[s], &a[s]);
+      iph_max = (iph[s] > iph_max) ? iph[s] : iph_max;
+    }
+    // Bracket: above the brightest substring every diode is reversed,
+    // below -V/Rs the series resistance alone exceeds V. Start from
+    // I = 0, the first evaluation usually pulls lo up to 0.
+    hi = iph_max + 1.0;
+    lo = -(vv > 0.0 ? vv : VSPLAT(0.0)) / panel->rs - 1.0;
+    cur = VSPLAT(0.0);
+    for (int it = 0; it < PV_ITER; it++) {
+      h = -vv;
+      dh = VSPLAT(0.0);
+      for (unsigned int s = 0; s < n_sub; s++) {
+        vs = substring_voltage(cur, iph[s], i0[s], a[s], rs, rsh,
+                               panel->v_bypass, &dvs);
+        h += vs;
+        dh += dvs;
+      }
+      // h decreasing in I, root is above cur when h > 0
+      lo = (h > 0.0) ? cur : lo;
+      hi = (h > 0.0) ? hi : cur;
+      next = (dh < 0.0) ? cur - h / dh : (lo + hi) * 0.5;
+      next = ((next < lo) | (next > hi)) ? (lo + hi) * 0.5 : next;
+      // Done once the step or the bracket is under tolerance
+      open = (((next - cur) > PV_TOL) | ((next - cur) < -PV_TOL)) & ((hi - lo) > PV_TOL);
+      cur = next;
+      if (!any_lane(open)) break;
+    }
+    for (size_t j = 0; j < m; j++) i[k + j] = cur[j];
+  }
+  return 1;
+}
@@ -0,0 +1,89 @@
+////////////////////////////////////////////////////////////////////////
+// pv_model.h
+// PV Panel Model Header File (host simulator)
+// by: Aistheta Gleason
+////////////////////////////////////////////////////////////////////////
+// Safety Note: Read the README!!! Keep Battery in well ventilated area
+////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////
+// Copyright and License
+////////////////////////////////////////////////////////////////////////
+// Copyright 2022, Aistheta (Adam) Gleason
+////////////////////////////////////////////////////////////////////////
+// This program is free software: you can redistribute it and/or modify 
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or 
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// (LICENSE) along with this program. If not, see 
+// https://www.gnu.org/licenses/
+
+////////////////////////////////////////////////////////////////////////
+// Single-diode panel model, solved in batches with portable SIMD
+// (GCC/Clang vector extensions, SSE2/AVX/NEON depending on -march)
+//   I = Iph - I0*(exp((V + I*Rs)/a) - 1) - (V + I*Rs)/Rsh
+//   a = n*Ns*k*T/q
+// Shaded panels are split into substrings, each with its own
+// irradiance and a bypass diode clamping it at -v_bypass.
+////////////////////////////////////////////////////////////////////////
+#ifndef PV_MODEL_H
+#define PV_MODEL_H
+
+////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////
+#include <stddef.h>
+
+////////////////////////////////////////////////////////////////////////
+// Constants
+////////////////////////////////////////////////////////////////////////
+// Maximum Number of Bypass Diode Substrings
+#define PV_MAX_SUB 8
+// STC Irradiance (W/m^2) and Temperature (C)
+#define PV_G_STC 1000.0
+#define PV_T_STC 25.0
+
+////////////////////////////////////////////////////////////////////////
+// Type Definitions
+////////////////////////////////////////////////////////////////////////
+// Panel Parameters (datasheet values at STC)
+typedef struct _pv_panel {
+  // Short Circuit Current (A) and Open Circuit Voltage (V)
+  double isc, voc;
+  // Diode Ideality Factor
+  double n;
+  // Cells in Series and Bypass Diode Substrings (cells split evenly)
+  unsigned int n_cells, n_sub;
+  // Series and Shunt Resistance (ohm, whole panel)
+  double rs, rsh;
+  // Isc (A/C) and Voc (V/C) Temperature Coefficients
+  double alpha_isc, beta_voc;
+  // Bypass Diode Forward Voltage (V)
+  double v_bypass;
+} PV_PANEL;
+
+////////////////////////////////////////////////////////////////////////
+// Function Prototypes
+////////////////////////////////////////////////////////////////////////
+// Default 100W 23Voc panel (36 cells, 3 bypass diodes)
+extern void pv_default_panel(PV_PANEL *panel);
+// Scalar reference, uniform irradiance g (W/m^2) and temperature t (C)
+extern double pv_current(const PV_PANEL *panel, double v, double g, double t);
+// Scalar reference, shaded: g holds n_sub irradiances (bisection, slow)
+extern double pv_current_shaded(const PV_PANEL *panel, double v, const double *g, double t);
+// Batch, uniform irradiance: i[k] = I(v[k], g[k], t[k])
+extern void pv_current_batch(const PV_PANEL *panel, const double *v,
+                             const double *g, const double *t,
+                             double *i, size_t n);
+// Batch, shaded: g holds n_sub irradiances per point (g[k*n_sub + s]),
+// returns 0 (i untouched) if n_sub is 0 or over PV_MAX_SUB
+extern bool pv_current_shaded_batch(const PV_PANEL *panel, const double *v,
+                                    const double *g, const double *t,
+                                    double *i, size_t n);
+
+#endif
@@ -0,0 +1,616 @@
+////////////////////////////////////////////////////////////////////////
+// sim.cpp
+// Host Simulator Main Source File
+// by: Aistheta Gleason
+////////////////////////////////////////////////////////////////////////
+// Safety Note: Read the README!!! Keep Battery in well ventilated area
+////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////
+// Copyright and License
+////////////////////////////////////////////////////////////////////////
+// Copyright 2022, Aistheta (Adam) Gleason
+////////////////////////////////////////////////////////////////////////
+// This program is free software: you can redistribute it and/or modify 
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or 
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// (LICENSE) along with this program. If not, see 
+// https://www.gnu.org/licenses/
+
+////////////////////////////////////////////////////////////////////////
+// Runs the unmodified firmware (Solar_Charger.ino, mppt.cpp, ...)
+// against the plant in virtual time. Build from the repo root:
+//   g++ -O2 -march=native -Wno-psabi -ISimulator -ISolar_Charger
+//     -x c++ Solar_Charger/Solar_Charger.ino -x none
+//     Solar_Charger/*.cpp Simulator/arduino.cpp Simulator/plant.cpp
+//     Simulator/pv_model.cpp Simulator/sim.cpp -o sim
+// Options:
+//   --time S          simulated seconds (default 30)
+//   --irr G           uniform irradiance, W/m^2 (default 1000)
+//   --shade G1,G2,..  irradiance per bypass substring
+//   --temp C          cell temperature (default 25)
+//   --step S:G        set uniform irradiance G at S seconds (repeatable)
+//   --voc V           battery open circuit voltage (default 12.4)
+//   --csv FILE        plant trace every --csv-ms (default 10) ms
+//   --iv FILE         write the panel I-V curve and exit
+//   --check-pv        check the batch panel solvers against the
+//                     scalar pv_current() over V, G and T and exit
+//   --console         feed stdin to the firmware's Serial
+//   --quiet           drop the firmware's Serial output
+//   --noise LSB       gaussian ADC noise, std dev in codes
+//   --pty LINK        serial on a new pseudo-terminal, LINK symlinks to
+//                     it; the board keeps its console up when charging
+//                     stops and resets after sleep_time (or clear)
+//   --realtime        hold virtual time to the wall clock
+//   --fault KIND:S    inject a fault at S seconds and time the trip
+//                     (ov, uv, oc or stuck, needs PROTECT)
+//   --sweep N         repeat the injection at N points across one PWM
+//                     period (forked from S) and report the worst case,
+//                     exits non-zero unless every point tripped and
+//                     stayed latched (or mppt() stopped the charger)
+////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////
+#include "Arduino.h"
+// Simulator Core
+#include "sim.h"
+// Plant
+#include "plant.h"
+// Firmware MPPT Library (state and duty cycle)
+#include "mppt.h"
+// Firmware Console (served while the board is idle)
+#include "console.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <time.h>
+#include <sys/wait.h>
+
+////////////////////////////////////////////////////////////////////////
+// Constants
+////////////////////////////////////////////////////////////////////////
+// Maximum Irradiance Steps
+#define MAX_STEPS 32
+// Injected Battery Voltages (V): pulled up by another source, shorted cells
+#define FAULT_OV_V 16.0
+#define FAULT_UV_V 8.0
+// Give up on a trip after (us)
+#define FAULT_TIMEOUT_US 1000000
+// Ticks run after a trip to check it stays latched (us)
+#define FAULT_HOLD_US 100000
+// --check-pv Sweep: voltage step (V), irradiance step (W/m^2), points
+#define PV_CHECK_DV 0.05
+#define PV_CHECK_DG 25.0
+#define PV_CHECK_N 1024
+// --check-pv Shaded Sweep: voltage step (V)
+#define PV_CHECK_SHADE_DV 0.25
+// --check-pv Bound: relative error, over at least this much current (A)
+// so the zero crossing at Voc doesn't divide by zero
+#define PV_CHECK_TOL 1e-6
+#define PV_CHECK_FLOOR 1e-3
+
+////////////////////////////////////////////////////////////////////////
+// Type Definitions
+////////////////////////////////////////////////////////////////////////
+// Irradiance Step Event
+typedef struct _irr_step {
+  double t, g;
+} IRR_STEP;
+// Fault Injection Kinds
+typedef enum _fault_kinds {K_NONE, K_OV, K_UV, K_OC, K_STUCK} FAULT_KINDS;
+// Fault Injection Result
+typedef struct _fault_result {
+  // Fault code latched (0 = no trip), charger stopped without a trip,
+  // and the trip held (code kept, SW1 off) FAULT_HOLD_US later
+  int code;
+  bool stopped, held;
+  // Fault onset to SW1 off (us), peak inductor current after injection (A)
+  double latency_us, i_peak;
+} FAULT_RESULT;
+
+////////////////////////////////////////////////////////////////////////
+// Function Prototypes
+////////////////////////////////////////////////////////////////////////
+// Firmware Entry Points (Solar_Charger.ino)
+extern void setup();
+extern void loop();
+
+////////////////////////////////////////////////////////////////////////
+// Global Variables
+////////////////////////////////////////////////////////////////////////
+// Irradiance Steps
+static IRR_STEP steps[MAX_STEPS];
+static int n_steps, next_step;
+// Trace File and Interval (ms)
+static FILE *csv;
+static double csv_ms = 10, next_csv;
+// Fault Injection Kind Names (FAULT_KINDS order)
+static const char *fault_names[] = {"none", "ov", "uv", "oc", "stuck"};
+// Pseudo-Terminal (-1 = none) and its Symlink
+static int pty = -1;
+static const char *pty_link;
+// Wall Clock Pacing
+static bool realtime;
+static struct timespec wall0;
+
+////////////////////////////////////////////////////////////////////////
+// Functions
+////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////
+// uniform() function
+// Sets every substring to irradiance g
+////////////////////////////////////////////////////////////////////////
+static void uniform(double g, double t) {
+  double gs[PV_MAX_SUB];
+  for (int s = 0; s < PV_MAX_SUB; s++) gs[s] = g;
+  plant_conditions(gs, t);
+}
+
+////////////////////////////////////////////////////////////////////////
+// write_iv() function
+// Writes the tabulated I-V curve as CSV
+////////////////////////////////////////////////////////////////////////
+static int write_iv(const char *path) {
+  FILE *f = fopen(path, "w");
+  double v;
+  if (!f) {
+    perror(path);
+    return 1;
+  }
+  fprintf(f, "v,i,p\n");
+  for (int k = 0; k < PLANT_TABLE; k++) {
+    v = k * plant.table_dv;
+    fprintf(f, "%.4f,%.5f,%.4f\n", v, plant.table_i[k], v * plant.table_i[k]);
+  }
+  fclose(f);
+  fprintf(stderr, "mpp %.2f W at %.2f V\n", plant.p_mpp, plant.v_mpp);
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// check_pv() function
+// Sweeps V (-2 V to 8 V past Voc), irradiance and temperature through
+// both batch solvers and compares each point with pv_current(). The
+// shaded solver gets the same irradiance on every substring, and only
+// V >= 0 (below that its bypass diodes conduct, which pv_current()
+// doesn't model). Then the shaded solver again with substrings at
+// different irradiance (bypass diodes conducting), from -1 V against
+// the bisection reference pv_current_shaded(). Returns 1 if any point
+// is off by more than PV_CHECK_TOL.
+////////////////////////////////////////////////////////////////////////
+static int check_pv() {
+  static double v[PV_CHECK_N], gg[PV_CHECK_N], tt[PV_CHECK_N];
+  static double gs[PV_CHECK_N * PV_MAX_SUB], i_batch[PV_CHECK_N], i_shaded[PV_CHECK_N];
+  const double temps[] = {-20.0, 0.0, PV_T_STC, 50.0, 75.0};
+  // Substring irradiances (W/m^2), past n_sub are ignored
+  const double shades[][PV_MAX_SUB] = {
+    {1000, 200, 1000, 1000, 1000, 1000, 1000, 1000},
+    {1000, 1000, 200, 1000, 1000, 1000, 1000, 1000},
+    {1000, 200, 200, 200, 200, 200, 200, 200},
+    {1000, 500, 50, 1000, 500, 50, 1000, 500},
+    {300, 1000, 1000, 300, 1000, 1000, 300, 1000},
+    {600, 600, 25, 600, 600, 25, 600, 600},
+    {1000, 0, 1000, 0, 1000, 0, 1000, 0}};
+  const PV_PANEL *panel = &plant.panel;
+  unsigned int n_sub = panel->n_sub;
+  double ref, err, worst_batch = 0, worst_shaded = 0, worst_partial = 0, v_max;
+  int n, points = 0, partial = 0;
+  // gs[] holds PV_MAX_SUB irradiances per point
+  if (n_sub == 0 || n_sub > PV_MAX_SUB) {
+    fprintf(stderr, "check-pv: panel has %u substrings, 1 to %d supported\n", n_sub, PV_MAX_SUB);
+    return 1;
+  }
+  for (double t : temps) {
+    v_max = panel->voc + panel->beta_voc * (t - PV_T_STC) + 8.0;
+    for (double g = PV_CHECK_DG; g <= 1.3 * PV_G_STC; g += PV_CHECK_DG) {
+      n = 0;
+      for (double x = -2.0; x <= v_max && n < PV_CHECK_N; x += PV_CHECK_DV) {
+        v[n] = x;
+        gg[n] = g;
+        tt[n] = t;
+        for (unsigned int s = 0; s < n_sub; s++) gs[n * n_sub + s] = g;
+        n++;
+      }
+      pv_current_batch(panel, v, gg, tt, i_batch, n);
+      pv_current_shaded_batch(panel, v, gs, tt, i_shaded, n);
+      for (int k = 0; k < n; k++) {
+        ref = pv_current(panel, v[k], g, t);
+        err = fabs(i_batch[k] - ref) / fmax(fabs(ref), PV_CHECK_FLOOR);
+        if (err > worst_batch) worst_batch = err;
+        if (err > PV_CHECK_TOL) {
+          fprintf(stderr, "batch off at %.2f V %.0f W/m^2 %.0f C: %.9f A, pv_current %.9f A\n",
+                  v[k], g, t, i_batch[k], ref);
+        }
+        if (v[k] < 0) continue;
+        err = fabs(i_shaded[k] - ref) / fmax(fabs(ref), PV_CHECK_FLOOR);
+        if (err > worst_shaded) worst_shaded = err;
+        if (err > PV_CHECK_TOL) {
+          fprintf(stderr, "shaded off at %.2f V %.0f W/m^2 %.0f C: %.9f A, pv_current %.9f A\n",
+                  v[k], g, t, i_shaded[k], ref);
+        }
+      }
+      points += n;
+    }
+    // Partial Shading
+    for (const double *shade : shades) {
+      n = 0;
+      for (double x = -1.0; x <= v_max && n < PV_CHECK_N; x += PV_CHECK_SHADE_DV) {
+        v[n] = x;
+        tt[n] = t;
+        for (unsigned int s = 0; s < n_sub; s++) gs[n * n_sub + s] = shade[s];
+        n++;
+      }
+      pv_current_shaded_batch(panel, v, gs, tt, i_shaded, n);
+      for (int k = 0; k < n; k++) {
+        ref = pv_current_shaded(panel, v[k], shade, t);
+        err = fabs(i_shaded[k] - ref) / fmax(fabs(ref), PV_CHECK_FLOOR);
+        if (err > worst_partial) worst_partial = err;
+        if (err > PV_CHECK_TOL) {
+          fprintf(stderr, "partial off at %.2f V %.0f/%.0f/%.0f W/m^2 %.0f C: %.9f A, reference %.9f A\n",
+                  v[k], shade[0], shade[1], shade[2], t, i_shaded[k], ref);
+        }
+      }
+      partial += n;
+    }
+  }
+  fprintf(stderr, "check-pv %d points: worst relative error batch %.2e, shaded %.2e (bound %.0e)\n",
+          points, worst_batch, worst_shaded, PV_CHECK_TOL);
+  fprintf(stderr, "check-pv %d partially shaded points: worst relative error %.2e\n", partial, worst_partial);
+  return worst_batch > PV_CHECK_TOL || worst_shaded > PV_CHECK_TOL || worst_partial > PV_CHECK_TOL;
+}
+
+////////////////////////////////////////////////////////////////////////
+// open_pty() function
+// Opens a raw pseudo-terminal for the firmware Serial and links LINK to
+// the terminal side, returns the controlling fd
+////////////////////////////////////////////////////////////////////////
+static int open_pty(const char *link) {
+  struct termios tio;
+  int fd = posix_openpt(O_RDWR | O_NOCTTY);
+  if (fd < 0 || grantpt(fd) || unlockpt(fd)) {
+    perror("pty");
+    return -1;
+  }
+  tcgetattr(fd, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(fd, TCSANOW, &tio);
+  // Nobody attached yet, writes must not block
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  unlink(link);
+  if (symlink(ptsname(fd), link)) {
+    perror(link);
+    return -1;
+  }
+  fprintf(stderr, "pty %s -> %s\n", link, ptsname(fd));
+  return fd;
+}
+
+////////////////////////////////////////////////////////////////////////
+// sim_pace() function
+// Sleeps while virtual time is ahead of the wall clock (--realtime)
+////////////////////////////////////////////////////////////////////////
+static void sim_pace() {
+  struct timespec now;
+  long long ahead;
+  if (!realtime) return;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  ahead = (long long) sim_us - ((now.tv_sec - wall0.tv_sec) * 1000000LL + (now.tv_nsec - wall0.tv_nsec) / 1000);
+  if (ahead > 1000) usleep(ahead);
+}
+
+////////////////////////////////////////////////////////////////////////
+// sim_step() function
+// One pass of the firmware loop(), plus irradiance steps and the trace
+////////////////////////////////////////////////////////////////////////
+static void sim_step() {
+  // Irradiance Steps (clouds)
+  if (next_step < n_steps && sim_us >= steps[next_step].t * 1e6) {
+    uniform(steps[next_step++].g, plant.t);
+  }
+  loop();
+  sim_advance(SIM_LOOP_US);
+  sim_pace();
+  // Trace
+  if (csv && sim_us >= next_csv * 1e3) {
+    fprintf(csv, "%.4f,%.3f,%.3f,%.3f,%.3f,%d,%d,%d,%.2f,%.2f\n", sim_us * 1e-6,
+            plant.v_c, plant_pv_current(plant.v_c), plant.v_bat, plant.i_l,
+            plant.sw, duty_cycle, cur_state,
+            plant.v_c * plant_pv_current(plant.v_c), plant.p_mpp);
+    next_csv += csv_ms;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// sim_done() function
+// Stands in for done_charging() on the pty, which would wait on the
+// console (latched fault) or sleep sleep_time without the virtual clock
+// moving. Serves the console in virtual time, then resets the board.
+////////////////////////////////////////////////////////////////////////
+static void sim_done(unsigned long long t_end) {
+  unsigned long long wake = sim_us + settings.sleep_time * 1000000ULL;
+  bool latched = 0;
+  // SW1 Off
+  timer_on = 0;
+  digitalWrite(SW1_PWM, LOW);
+#ifdef SYNC_SAMPLE
+  sw_on = 0;
+#endif
+  while (sim_us < t_end) {
+#ifdef CONSOLE
+    console_poll();
+#endif
+    sim_advance(SIM_LOOP_US);
+    sim_pace();
+#ifdef PROTECT
+    // Latched until the console clears it, then straight to reset
+    if (fault) {
+      latched = 1;
+      continue;
+    }
+    if (latched) break;
+#endif
+    if (sim_us >= wake) break;
+  }
+  // Reset
+  if (sim_us < t_end) setup();
+}
+
+#ifdef PROTECT
+////////////////////////////////////////////////////////////////////////
+// inject() function
+// Applies a fault to the plant (or the ADC)
+////////////////////////////////////////////////////////////////////////
+static void inject(int kind) {
+  switch (kind) {
+    case K_OV:
+      plant.v_oc0 = FAULT_OV_V;
+      break;
+    case K_UV:
+      plant.v_oc0 = FAULT_UV_V;
+      break;
+    case K_OC:
+      // Panel with twice the cells hooked up, VL past the sense range
+      plant.panel.n_cells *= 2;
+      plant.panel.voc *= 2;
+      plant.panel.beta_voc *= 2;
+      plant.panel.rs *= 2;
+      plant.panel.rsh *= 2;
+      plant_conditions(plant.g, plant.t);
+      break;
+    case K_STUCK:
+      sim_adc_stuck = VL_ADC;
+      break;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// run_fault() function
+// Runs to t_us, injects the fault and runs until the firmware trips.
+// Onset is the injection, or for oc when the plant current first passes
+// PROT_IL_MAX (a trip before that counts as 0 us).
+////////////////////////////////////////////////////////////////////////
+static FAULT_RESULT run_fault(int kind, unsigned long long t_us) {
+  FAULT_RESULT r;
+  unsigned long long onset, t_end;
+  while (sim_us < t_us && cur_state != DONE_CHG) sim_step();
+  inject(kind);
+  onset = sim_us;
+  plant.i_peak = 0;
+  if (kind == K_OC) {
+    plant.i_over = PROT_IL_MAX;
+    plant.t_over_us = 0;
+  }
+  t_end = sim_us + FAULT_TIMEOUT_US;
+  while (!fault && cur_state != DONE_CHG && sim_us < t_end) sim_step();
+  if (kind == K_OC) onset = plant.t_over_us ? plant.t_over_us : sim_sw1_low_us;
+  r.code = fault;
+  r.stopped = !fault && cur_state == DONE_CHG;
+  r.latency_us = (fault && sim_sw1_low_us > onset) ? (double) (sim_sw1_low_us - onset) : 0;
+  r.i_peak = plant.i_peak;
+  // The interrupt keeps ticking while the main loop waits in
+  // done_charging(), nothing but the console may undo the trip
+  r.held = 0;
+  if (fault) {
+    sim_advance(FAULT_HOLD_US);
+    r.held = fault == r.code && !timer_on && !sim_sw1;
+  }
+  return r;
+}
+
+////////////////////////////////////////////////////////////////////////
+// sweep_fault() function
+// Runs to t_s, then forks one copy per injection point spread across a
+// PWM period so every phase of the on/off cycle gets hit
+////////////////////////////////////////////////////////////////////////
+static int sweep_fault(int kind, double t_s, int n) {
+  FAULT_RESULT r;
+  double period_us, worst = 0, sum = 0, i_peak = 0;
+  int fd[2], trips = 0, stopped = 0, held = 0, codes[F_STUCK + 1] = {0};
+  pid_t pid;
+  while (sim_us < t_s * 1e6 && cur_state != DONE_CHG) sim_step();
+  period_us = 1e6 / settings.pwm_freq;
+  if (pipe(fd)) {
+    perror("pipe");
+    return 1;
+  }
+  for (int k = 0; k < n; k++) {
+    fflush(stdout);
+    if (csv) fflush(csv);
+    if ((pid = fork()) < 0) {
+      perror("fork");
+      return 1;
+    }
+    if (pid == 0) {
+      // Child, trace stays with the parent
+      csv = 0;
+      r = run_fault(kind, sim_us + (unsigned long long) (k * period_us / n));
+      if (write(fd[1], &r, sizeof(r)) != sizeof(r)) _exit(1);
+      _exit(0);
+    }
+    waitpid(pid, 0, 0);
+    if (read(fd[0], &r, sizeof(r)) != sizeof(r)) continue;
+    if (r.code) {
+      trips++;
+      held += r.held;
+      codes[r.code]++;
+      sum += r.latency_us;
+      if (r.latency_us > worst) worst = r.latency_us;
+    }
+    if (r.stopped) stopped++;
+    if (r.i_peak > i_peak) i_peak = r.i_peak;
+  }
+  fprintf(stderr, "fault %s at %.3f s over %d phases: %d tripped (%d held), %d stopped by mppt(), "
+          "SW1 off after worst %.0f us, mean %.0f us, peak %.2f A\n",
+          fault_names[kind], t_s, n, trips, held, stopped, worst, trips ? sum / trips : 0, i_peak);
+  fprintf(stderr, "codes:");
+  for (int c = F_OV; c <= F_STUCK; c++) if (codes[c]) fprintf(stderr, " %s x%d", fault_names[c], codes[c]);
+  fprintf(stderr, "\n");
+  return (trips + stopped == n && held == trips) ? 0 : 1;
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// main() function
+////////////////////////////////////////////////////////////////////////
+int main(int argc, char **argv) {
+  double t_end = 30, g = PV_G_STC, t = PV_T_STC, t_fault = 0;
+  double shade[PV_MAX_SUB];
+  bool shaded = 0, console = 0, quiet = 0, check = 0;
+  const char *csv_path = 0, *iv_path = 0;
+  int kind = K_NONE, n_sweep = 0;
+  char *tok;
+
+  plant_default();
+  // Parse Options
+  for (int k = 1; k < argc; k++) {
+    if (!strcmp(argv[k], "--time") && k + 1 < argc) t_end = atof(argv[++k]);
+    else if (!strcmp(argv[k], "--irr") && k + 1 < argc) g = atof(argv[++k]);
+    else if (!strcmp(argv[k], "--temp") && k + 1 < argc) t = atof(argv[++k]);
+    else if (!strcmp(argv[k], "--voc") && k + 1 < argc) plant.v_oc0 = atof(argv[++k]);
+    else if (!strcmp(argv[k], "--csv") && k + 1 < argc) csv_path = argv[++k];
+    else if (!strcmp(argv[k], "--csv-ms") && k + 1 < argc) csv_ms = atof(argv[++k]);
+    else if (!strcmp(argv[k], "--iv") && k + 1 < argc) iv_path = argv[++k];
+    else if (!strcmp(argv[k], "--check-pv")) check = 1;
+    else if (!strcmp(argv[k], "--console")) console = 1;
+    else if (!strcmp(argv[k], "--quiet")) quiet = 1;
+    else if (!strcmp(argv[k], "--noise") && k + 1 < argc) sim_adc_noise = atof(argv[++k]);
+    else if (!strcmp(argv[k], "--pty") && k + 1 < argc) pty_link = argv[++k];
+    else if (!strcmp(argv[k], "--realtime")) realtime = 1;
+    else if (!strcmp(argv[k], "--sweep") && k + 1 < argc) n_sweep = atoi(argv[++k]);
+    else if (!strcmp(argv[k], "--shade") && k + 1 < argc) {
+      shaded = 1;
+      tok = strtok(argv[++k], ",");
+      for (unsigned int s = 0; s < plant.panel.n_sub; s++) {
+        shade[s] = tok ? atof(tok) : shade[s - 1];
+        if (tok) tok = strtok(0, ",");
+      }
+      if (tok) {
+        fprintf(stderr, "--shade takes at most %u irradiances (one per substring)\n", plant.panel.n_sub);
+        return 2;
+      }
+    } else if (!strcmp(argv[k], "--step") && k + 1 < argc && n_steps < MAX_STEPS) {
+      steps[n_steps].t = atof(argv[++k]);
+      tok = strchr(argv[k], ':');
+      steps[n_steps++].g = tok ? atof(tok + 1) : g;
+    } else if (!strcmp(argv[k], "--fault") && k + 1 < argc) {
+      tok = strchr(argv[++k], ':');
+      if (tok) *tok++ = 0;
+      t_fault = tok ? atof(tok) : 0;
+      for (int f = K_OV; f <= K_STUCK; f++) if (!strcmp(argv[k], fault_names[f])) kind = f;
+      if (kind == K_NONE) {
+        fprintf(stderr, "unknown fault %s (ov, uv, oc, stuck)\n", argv[k]);
+        return 2;
+      }
+    } else {
+      fprintf(stderr, "usage: %s [--time S] [--irr G] [--shade G1,G2,..] [--temp C] "
+              "[--step S:G]... [--voc V] [--csv FILE] [--csv-ms MS] [--iv FILE] [--check-pv] "
+              "[--console] [--quiet] [--noise LSB] [--pty LINK] [--realtime] [--fault KIND:S [--sweep N]]\n", argv[0]);
+      return 2;
+    }
+  }
+#ifndef PROTECT
+  if (kind != K_NONE) {
+    fprintf(stderr, "--fault needs the firmware built with PROTECT\n");
+    return 2;
+  }
+#endif
+  // Panel Conditions
+  if (shaded) plant_conditions(shade, t);
+  else uniform(g, t);
+  if (iv_path) return write_iv(iv_path);
+  if (check) return check_pv();
+  // Battery starts at rest
+  plant.v_bat = plant.v_oc0;
+  // Serial
+  if (!quiet) sim_serial_out = STDOUT_FILENO;
+  if (console) {
+    sim_serial_in = STDIN_FILENO;
+    fcntl(sim_serial_in, F_SETFL, fcntl(sim_serial_in, F_GETFL) | O_NONBLOCK);
+  }
+  if (pty_link) {
+    if ((pty = open_pty(pty_link)) < 0) return 1;
+    sim_serial_in = sim_serial_out = pty;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &wall0);
+  if (csv_path) {
+    if (!(csv = fopen(csv_path, "w"))) {
+      perror(csv_path);
+      return 1;
+    }
+    fprintf(csv, "t,v_solar,i_pv,v_battery,i_l,sw,duty_cycle,state,p_pv,p_mpp\n");
+  }
+
+  // Run Firmware
+  setup();
+#ifdef BENCH
+  // Benchmark ran in setup()
+  if (csv) fclose(csv);
+  return 0;
+#endif
+#ifdef PROTECT
+  if (kind != K_NONE && n_sweep > 0) {
+    // Worst case over the PWM period
+    int ret = sweep_fault(kind, t_fault, n_sweep);
+    if (csv) fclose(csv);
+    return ret;
+  } else if (kind != K_NONE) {
+    FAULT_RESULT r = run_fault(kind, (unsigned long long) (t_fault * 1e6));
+    fprintf(stderr, "fault %s at %.3f s: code %d (%s%s), SW1 off after %.0f us, peak %.2f A\n",
+            fault_names[kind], t_fault, r.code, fault_names[r.code],
+            (r.code && !r.held) ? ", not held" : "", r.latency_us, r.i_peak);
+    // Only the pty keeps the board running past the trip
+    if (pty < 0) t_end = 0;
+  }
+#endif
+  while (sim_us < t_end * 1e6) {
+    // Charger stopped (done_charging() would sleep and reset)
+    if (cur_state == DONE_CHG) {
+      if (pty < 0) break;
+      sim_done(t_end * 1e6);
+      continue;
+    }
+    sim_step();
+  }
+  if (csv) fclose(csv);
+  if (pty_link) unlink(pty_link);
+
+  // Summary
+  fprintf(stderr, "time %.2f s, state %d, duty %d %%\n", sim_us * 1e-6, cur_state, duty_cycle);
+  fprintf(stderr, "panel %.1f J of %.1f J available (tracking %.1f %%), mpp %.2f W at %.2f V\n",
+          plant.e_pv, plant.e_mpp, plant.e_mpp > 0 ? 100 * plant.e_pv / plant.e_mpp : 0,
+          plant.p_mpp, plant.v_mpp);
+  fprintf(stderr, "battery %.1f J, %.4f Ah in\n", plant.e_bat, plant.q_ah);
+#ifdef PROTECT
+  if (fault) fprintf(stderr, "fault %d latched\n", fault);
+#endif
+  return 0;
+}
@@ -0,0 +1,66 @@
+////////////////////////////////////////////////////////////////////////
+// sim.h
+// Simulator Core Header File (host simulator)
+// by: Aistheta Gleason
+////////////////////////////////////////////////////////////////////////
+// Safety Note: Read the README!!! Keep Battery in well ventilated area
+////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////
+// Copyright and License
+////////////////////////////////////////////////////////////////////////
+// Copyright 2022, Aistheta (Adam) Gleason
+////////////////////////////////////////////////////////////////////////
+// This program is free software: you can redistribute it and/or modify 
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or 
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// (LICENSE) along with this program. If not, see 
+// https://www.gnu.org/licenses/
+
+#ifndef SIM_H
+#define SIM_H
+
+////////////////////////////////////////////////////////////////////////
+// Constants
+////////////////////////////////////////////////////////////////////////
+// AVR Costs (us of virtual time) at 16MHz
+// analogRead (13 ADC clocks at 125kHz plus overhead)
+#define SIM_ADC_US 112
+// The conversion alone (13 ADC clocks at 125kHz)
+#define SIM_ADC_CONV_US 104
+// Starting or reading back a conversion (register access only)
+#define SIM_ADC_REG_US 1
+// digitalWrite
+#define SIM_GPIO_US 5
+// One pass of loop() outside the calls above (float math, state machine)
+#define SIM_LOOP_US 50
+
+////////////////////////////////////////////////////////////////////////
+// Global Variables
+////////////////////////////////////////////////////////////////////////
+// Virtual Time (us)
+extern unsigned long long sim_us;
+// Serial File Descriptors (-1 = not connected)
+extern int sim_serial_in, sim_serial_out;
+// SW1 Pin Level
+extern int sim_sw1;
+// Time SW1 was last driven low (us)
+extern unsigned long long sim_sw1_low_us;
+// ADC pin frozen at its last code (-1 = none), fault injection
+extern int sim_adc_stuck;
+// ADC Noise (std dev in codes, 0 = none)
+extern double sim_adc_noise;
+
+////////////////////////////////////////////////////////////////////////
+// Function Prototypes
+////////////////////////////////////////////////////////////////////////
+// Advance virtual time, stepping the plant and firing due timer ticks
+extern void sim_advance(unsigned long us);
+
+#endif
@@ -34,14 +34,27 @@
 #include "mppt.h"
 // Config Library
 #include "config.h"
+#ifdef CONSOLE
+// Console Library
+#include "console.h"
+#endif
+#ifdef BENCH
+// Benchmark Library
+#include "bench.h"
+#endif
 
 ////////////////////////////////////////////////////////////////////////
 // setup() function
 // Arduino Main Setup Function
 ////////////////////////////////////////////////////////////////////////
 void setup() {
+#ifdef BENCH
+  // Time the Hot Paths instead of charging
+  run_bench();
+#else
   // Setup the charger
   setup_charger();
+#endif
 }
 
 
@@ -50,6 +63,12 @@ void setup() {
 // Arduino Main Loop Function
 ////////////////////////////////////////////////////////////////////////
 void loop() {
+#ifndef BENCH
   // Run Charger State Machine
   charger_state_machine();
+#ifdef CONSOLE
+  // Service Console Commands (between states, never inside one)
+  console_poll();
+#endif
+#endif
 }
@@ -0,0 +1,438 @@
+////////////////////////////////////////////////////////////////////////
+// bench.cpp
+// Hot Path Benchmark Source File
+// by: Aistheta Gleason
+////////////////////////////////////////////////////////////////////////
+// Safety Note: Read the README!!! Keep Battery in well ventilated area
+////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////
+// Copyright and License
+////////////////////////////////////////////////////////////////////////
+// Copyright 2022, Aistheta (Adam) Gleason
+////////////////////////////////////////////////////////////////////////
+// This program is free software: you can redistribute it and/or modify 
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or 
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// (LICENSE) along with this program. If not, see 
+// https://www.gnu.org/licenses/
+////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////
+// Times the charger hot paths one call at a time: the measurement
+// macros, the integrate() trapezoid, integrate_samples(), the P&O step
+// (or rcc()), protect() and pwm_handler() ticks. Where an integer
+// version is a candidate it runs next to the float one. Output is CSV:
+//   case,variant,per_call,unit,us
+// On the AVR per_call is in cycles (Timer1 at F_CPU) and us follows
+// from F_CPU. On the host per_call is host ns and us is the virtual
+// time the simulator's AVR cost model charges (ADC conversions etc).
+////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////
+// Load Config
+#include "config.h"
+#ifdef BENCH
+// MPPT Library
+#include "mppt.h"
+// Benchmark Header
+#include "bench.h"
+#ifndef __AVR__
+#include <time.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// Constants
+////////////////////////////////////////////////////////////////////////
+#ifdef __AVR__
+// Calls per Case
+#define BENCH_N BENCH_CALLS
+// Unit of per_call
+#define BENCH_UNIT "cycles"
+#else
+// Host clock jitter is larger, average more calls and keep the fastest
+// of BENCH_REPS loops (preemption only ever adds time)
+#define BENCH_N (BENCH_CALLS * 4096L)
+#define BENCH_REPS 7
+#define BENCH_UNIT "ns"
+#endif
+// VL mV per ADC code (Q8), integer variants
+#define BENCH_VL_MV_Q8 ((long) (ADC_COEF*VL_COEF*1000.0*256.0 + 0.5))
+
+
+////////////////////////////////////////////////////////////////////////
+// Global Variables
+////////////////////////////////////////////////////////////////////////
+// Results (volatile so the work isn't optimized away)
+volatile double bench_d;
+volatile long bench_l;
+// Inputs (volatile so they aren't folded into constants)
+volatile int bench_code, bench_code_prev;
+volatile double bench_vl_cur, bench_vl_prev;
+volatile unsigned long bench_dt;
+// Integral Scale of the integer integrate_samples() (Q8, us*V per code)
+long bench_k_q8;
+// Timing Overhead of an empty call (cycles)
+long bench_overhead;
+// Flips perturb_observe() between slopes
+bool bench_up;
+
+
+////////////////////////////////////////////////////////////////////////
+// Functions
+////////////////////////////////////////////////////////////////////////
+
+// Empty Step
+void b_none() {}
+
+#ifdef __AVR__
+////////////////////////////////////////////////////////////////////////
+// time_call() function
+// Cycles of one call, interrupts held off
+////////////////////////////////////////////////////////////////////////
+long time_call(BENCH_FN fn) {
+  unsigned long c;
+  noInterrupts();
+  TCNT1 = 0;
+  // Clear Overflow Flag, one overflow (up to 131071 cycles) is counted
+  TIFR1 = _BV(TOV1);
+  fn();
+  c = TCNT1;
+  if (TIFR1 & _BV(TOV1)) c += 65536UL;
+  interrupts();
+  return c;
+}
+#else
+////////////////////////////////////////////////////////////////////////
+// time_loop() function
+// Host ns and model us of BENCH_N prepared calls, fastest of BENCH_REPS
+// loops (a single call is below the host clock resolution, so whole
+// loops are timed)
+////////////////////////////////////////////////////////////////////////
+double time_loop(BENCH_FN prep, BENCH_FN fn, double *us) {
+  struct timespec t0, t1;
+  double ns, best = -1;
+  unsigned long model = 0, m0;
+  for (unsigned char r = 0; r < BENCH_REPS; r++) {
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (long i = 0; i < BENCH_N; i++) {
+      prep();
+      // Model time of the call alone (prep() can wait on the ADC)
+      m0 = micros();
+      fn();
+      model += micros() - m0;
+      // Barrier, each call's stores land before the next prep()
+      __asm__ __volatile__("" ::: "memory");
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+    if (best < 0 || ns < best) best = ns;
+  }
+  *us = (double) model / BENCH_REPS;
+  return best;
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// bench() function
+// Averages BENCH_N prepared calls and prints one CSV row, returns us
+////////////////////////////////////////////////////////////////////////
+double bench(const __FlashStringHelper *name, const __FlashStringHelper *variant,
+             BENCH_FN prep, BENCH_FN fn) {
+  double per_call, us;
+#ifdef __AVR__
+  double total = 0;
+  for (long i = 0; i < BENCH_N; i++) {
+    prep();
+    total += time_call(fn);
+  }
+  per_call = total / BENCH_N - bench_overhead;
+  if (per_call < 0) per_call = 0;
+  us = per_call / (F_CPU / 1e6);
+#else
+  double us_none;
+  // Less the same loop with an empty call
+  per_call = time_loop(prep, fn, &us) - time_loop(prep, b_none, &us_none);
+  per_call = per_call > 0 ? per_call / BENCH_N : 0;
+  us = (us - us_none) / BENCH_N;
+#endif
+  if (name) {
+    Serial.print(name);
+    Serial.print(F(","));
+    Serial.print(variant);
+    Serial.print(F(","));
+    Serial.print(per_call, 1);
+    Serial.print(F("," BENCH_UNIT ","));
+    Serial.println(us, 2);
+  }
+  return us;
+}
+
+////////////////////////////////////////////////////////////////////////
+// Prepare and Run Steps
+////////////////////////////////////////////////////////////////////////
+// New input code each call
+void p_code() {
+  bench_code_prev = bench_code;
+  bench_code = 700 + ((bench_code + 37) & 255);
+  bench_vl_prev = bench_vl_cur;
+  bench_vl_cur = ((bench_code * ADC_COEF) + VL_OFF) * VL_COEF;
+  bench_dt = 333;
+}
+// Measurement Macros (conversion included)
+void b_adc_read() { bench_l = adc_read(VL_ADC); }
+void b_vbat_meas() { bench_d = VBAT_MEAS; }
+void b_vl_meas() { bench_d = VL_MEAS; }
+void b_vsol_meas() { bench_d = VSOL_MEAS; }
+// VL Scaling only, volts as double or millivolts as long
+void b_vl_scale_f() { bench_d = (bench_code * ADC_COEF + VL_OFF) * VL_COEF; }
+void b_vl_scale_i() { bench_l = ((long) bench_code - VL_ZERO) * BENCH_VL_MV_Q8 >> 8; }
+// integrate() Trapezoid Step, volts*us as double or codes*us as long
+void b_trap_f() {
+  double vl_cur = bench_vl_cur, vl_prev = bench_vl_prev;
+  if (vl_cur >= vl_prev) {
+    bench_d += (vl_prev + (vl_cur - vl_prev) / 2.0) * bench_dt;
+  } else {
+    bench_d += (vl_cur + (vl_prev - vl_cur) / 2.0) * bench_dt;
+  }
+}
+void b_trap_i() { bench_l += ((long) bench_code_prev + bench_code - 2 * VL_ZERO) * (long) bench_dt / 2; }
+#ifndef SYNC_SAMPLE
+// integrate() as built (main loop VL sampling)
+void p_integrate() { new_integral = 1; }
+void b_integrate() { integrate(); }
+#endif
+// Power, double volts times integral or VBAT code times integral
+void p_power() {
+  p_code();
+  v_battery = bench_code * VBAT_COEF;
+  integral_avg = 36000 + bench_code;
+}
+void b_power_f() { p_cur = v_battery * integral_avg; }
+void b_power_i() { bench_l = (long) bench_code * integral_avg; }
+#ifdef SYNC_SAMPLE
+// On-Time Samples of a 50% period
+void p_samples() {
+  for (unsigned char k = 0; k < N_SAMPLES; k++) {
+    snap_vl[k] = 1000 - 40 * k;
+#ifdef MPPT_RCC
+    snap_vsol[k] = 600 - 30 * k;
+#endif
+  }
+  snap_n = N_SAMPLES;
+  snap_duty = BENCH_DUTY;
+  snap_step = (BENCH_DUTY - BLANK_TICKS) / N_SAMPLES;
+  v_battery = 12.6;
+  v_solar = 20.0;
+}
+void b_samples_f() { integrate_samples(); }
+void b_samples_i() {
+  long vl_sum = 0;
+  for (unsigned char i = 0; i < snap_n; i++) vl_sum += snap_vl[i];
+  bench_l = ((vl_sum - (long) snap_n * VL_ZERO) * snap_duty / snap_n) * bench_k_q8 >> 8;
+}
+#endif
+#ifdef MPPT_RCC
+void b_rcc() { rcc(); }
+#else
+// Alternate Power Slopes so both branches run
+void p_po() {
+  bench_up = !bench_up;
+  p_prev = 1000;
+  p_cur = bench_up ? 1001 : 999;
+  duty_cycle = BENCH_DUTY;
+}
+void b_po() { perturb_observe(); }
+#endif
+#ifdef MPPT_KF
+// Noisy Power at a known Level
+void p_kf() {
+  p_code();
+  kf_known = 1;
+  kf_r = 1e6;
+}
+void b_kf() { kf_update(400000.0 + bench_code * 16); }
+#endif
+#ifdef PROTECT
+// Mid On-Time, inductor charging, nothing tripped
+void p_protect() {
+  timer_on = 1;
+  cur_state = MPPT;
+  fault = F_NONE;
+  sw_on = 1;
+  pwm_count = BENCH_DUTY / 2;
+  prot_read = 1;
+  prot_il = 0;
+  prot_vl = VL_ZERO + 100;
+}
+void b_protect() { protect(); }
+#endif
+#ifdef SYNC_SAMPLE
+// pwm_handler() On-Time Tick, next tick is a sample tick or not
+void p_tick(unsigned char next) {
+  timer_on = 1;
+  cur_state = MPPT;
+  sw_on = 1;
+  duty_cycle = BENCH_DUTY;
+  pwm_count = 9;
+  sample_tick = next;
+  sample_step = (BENCH_DUTY - BLANK_TICKS) / N_SAMPLES;
+  n_samples = 0;
+#ifdef PROTECT
+  fault = F_NONE;
+  prot_il = 0;
+  prot_vl = VL_ZERO;
+  // Last tick's own conversion finished, waiting to be read back
+  prot_collect();
+  prot_pend = VL_ADC;
+  adc_start(VL_ADC);
+  while (adc_busy());
+#endif
+}
+void p_tick_sample() { p_tick(10); }
+void p_tick_plain() { p_tick(20); }
+void b_tick() { pwm_handler(); }
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// on_time_rows() function
+// Tick budget and samples per On-Time at PWM Frequency F, one sample
+// per tick the way pwm_handler() takes them, and ADC bound (back to
+// back conversions). tick_load is the worst tick, tick_avg_load the
+// interrupt's share of a period (N_SAMPLES sample ticks, rest plain).
+////////////////////////////////////////////////////////////////////////
+void on_time_rows(unsigned int f, double tick_worst_us, double sample_us, double plain_us) {
+  double tick_us = BASE_PER(f) * 1e6;
+  double on_us = (BENCH_DUTY - BLANK_TICKS) * tick_us;
+#ifdef SYNC_SAMPLE
+  double avg_us = (N_SAMPLES * sample_us + (100 - N_SAMPLES) * plain_us) / 100;
+#else
+  double avg_us = plain_us;
+#endif
+  Serial.print(F("tick_load,"));
+  Serial.print(f);
+  Serial.print(F("Hz,"));
+  Serial.print(100 * tick_worst_us / tick_us, 1);
+  Serial.print(F(",%,"));
+  Serial.println(tick_worst_us, 2);
+  Serial.print(F("tick_avg_load,"));
+  Serial.print(f);
+  Serial.print(F("Hz,"));
+  Serial.print(100 * avg_us / tick_us, 1);
+  Serial.print(F(",%,"));
+  Serial.println(avg_us, 2);
+  Serial.print(F("on_time_samples,"));
+  Serial.print(f);
+  Serial.print(F("Hz_d"));
+  Serial.print(BENCH_DUTY);
+  Serial.print(F(","));
+  Serial.print(tick_worst_us < tick_us ? BENCH_DUTY - BLANK_TICKS : 0);
+  Serial.print(F(",samples,"));
+  Serial.println(on_us, 0);
+  Serial.print(F("on_time_adc_bound,"));
+  Serial.print(f);
+  Serial.print(F("Hz_d"));
+  Serial.print(BENCH_DUTY);
+  Serial.print(F(","));
+  Serial.print(sample_us > 0 ? (long) (on_us / sample_us) : 0);
+  Serial.print(F(",samples,"));
+  Serial.println(on_us, 0);
+}
+
+////////////////////////////////////////////////////////////////////////
+// run_bench() function
+// Runs every case once and prints the CSV, ends with "END"
+////////////////////////////////////////////////////////////////////////
+void run_bench() {
+  double tick_sample_us = 0, tick_plain_us = 0;
+  Serial.begin(BENCH_BAUD);
+  default_settings();
+  pinMode(VBAT_ADC, INPUT);
+  pinMode(VL_ADC, INPUT);
+  pinMode(VSOL_ADC, INPUT);
+#ifdef __AVR__
+  // Timer1 free running at F_CPU as the cycle counter (charger is off)
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10);
+  TIMSK1 = 0;
+#endif
+#ifdef PROTECT
+  // Trip Levels as apply_settings() sets them (it also re-times Timer1)
+  prot_il_max = PROT_IL_CODES(settings.pwm_freq);
+  prot_il_decay = PROT_IL_DECAY(settings.pwm_freq);
+#endif
+  bench_k_q8 = (long) (ADC_COEF * VL_COEF * BASE_PER(settings.pwm_freq) * 1e6 * 256.0 + 0.5);
+  // Calibrate out the cost of timing an empty call
+#ifdef __AVR__
+  double overhead = 0;
+  for (long i = 0; i < BENCH_N; i++) overhead += time_call(b_none);
+  bench_overhead = overhead / BENCH_N;
+#endif
+  // Build
+  Serial.print(F("# PWM_FREQ="));
+  Serial.print(settings.pwm_freq);
+  Serial.print(F(" N_SAMPLES="));
+#ifdef SYNC_SAMPLE
+  Serial.print(N_SAMPLES);
+#else
+  Serial.print(0);
+#endif
+#ifdef MPPT_RCC
+  Serial.print(F(" MPPT_RCC"));
+#endif
+#ifdef PROTECT
+  Serial.print(F(" PROTECT"));
+#endif
+  Serial.print(F(" overhead="));
+  Serial.println(bench_overhead);
+  Serial.println(F("case,variant,per_call,unit,us"));
+  // Measurement Macros
+  bench(F("adc_read"), F("int"), p_code, b_adc_read);
+  bench(F("vbat_meas"), F("float"), p_code, b_vbat_meas);
+  bench(F("vl_meas"), F("float"), p_code, b_vl_meas);
+  bench(F("vsol_meas"), F("float"), p_code, b_vsol_meas);
+  bench(F("vl_scale"), F("float"), p_code, b_vl_scale_f);
+  bench(F("vl_scale"), F("int"), p_code, b_vl_scale_i);
+  // Integration
+  bench(F("trapezoid"), F("float"), p_code, b_trap_f);
+  bench(F("trapezoid"), F("int"), p_code, b_trap_i);
+#ifndef SYNC_SAMPLE
+  bench(F("integrate"), F("float"), p_integrate, b_integrate);
+#else
+  bench(F("integrate_samples"), F("float"), p_samples, b_samples_f);
+  bench(F("integrate_samples"), F("int"), p_samples, b_samples_i);
+#endif
+  // MPPT
+  bench(F("power"), F("float"), p_power, b_power_f);
+  bench(F("power"), F("int"), p_power, b_power_i);
+#ifdef MPPT_RCC
+  bench(F("rcc"), F("float"), p_samples, b_rcc);
+#else
+  bench(F("perturb_observe"), F("float"), p_po, b_po);
+#endif
+#ifdef MPPT_KF
+  bench(F("kf_update"), F("float"), p_kf, b_kf);
+#endif
+#ifdef PROTECT
+  bench(F("protect"), F("int"), p_protect, b_protect);
+#endif
+#ifdef SYNC_SAMPLE
+  // Timer Interrupt Ticks
+  tick_sample_us = bench(F("tick_sample"), F("int"), p_tick_sample, b_tick);
+  tick_plain_us = bench(F("tick_plain"), F("int"), p_tick_plain, b_tick);
+  on_time_rows(settings.pwm_freq, tick_sample_us > tick_plain_us ? tick_sample_us : tick_plain_us, tick_sample_us, tick_plain_us);
+  if (PWM_FREQ_MAX != settings.pwm_freq) {
+    on_time_rows(PWM_FREQ_MAX, tick_sample_us > tick_plain_us ? tick_sample_us : tick_plain_us, tick_sample_us, tick_plain_us);
+  }
+#endif
+  Serial.println(F("END"));
+}
+#endif
@@ -46,11 +46,9 @@ volatile CAL_STATES cur_cal_state;
 // input byte variable
 char inbyte;
 // Input Byte Buffer
-char inbytes[100];
+char inbytes[CAL_LINE];
 // Input Byte Buffer Index
-char inbyte_i;
-// Temp string for sprintfs
-char tempstr[100];
+unsigned char inbyte_i;
 // Calibrating flag
 bool calibrating;
 // Battery Average
@@ -58,7 +56,7 @@ double avg_bat;
 // Solar Average
 double avg_sol;
 // Number of MPPTs
-int n_mppt;
+unsigned char n_mppt;
 
 ////////////////////////////////////////////////////////////////////////
 // Functions
@@ -73,10 +71,10 @@ void setup_calibration() {
   Serial.begin(115200);
   delay(1000);
   // Print Beggining Test
-  Serial.println("-----------------------------------");
-  Serial.println("Solar Charger Calibration and Self Test Report");
-  Serial.println("Type Y and Press Enter to Begin");
-  Serial.println("-----------------------------------");
+  Serial.println(F("-----------------------------------"));
+  Serial.println(F("Solar Charger Calibration and Self Test Report"));
+  Serial.println(F("Type Y and Press Enter to Begin"));
+  Serial.println(F("-----------------------------------"));
   // set current state
   cur_cal_state = INIT_CAL;
   // Set inbyte to 0
@@ -120,16 +118,18 @@ void calibration_state_machine() {
       // Measure battery and solar voltages
       check_battery();
       check_solar();
-      Serial.println("Measuring Battery and Solar Voltages");
-      Serial.println("-----------------------------------");
-      sprintf(tempstr, "Battery Voltage = %f V", v_battery);
-      Serial.println(tempstr);
-      sprintf(tempstr, "Solar Voltage = %f V", v_solar);
-      Serial.println(tempstr);
-      Serial.println("-----------------------------------");
+      Serial.println(F("Measuring Battery and Solar Voltages"));
+      Serial.println(F("-----------------------------------"));
+      Serial.print(F("Battery Voltage = "));
+      Serial.print(v_battery, 3);
+      Serial.println(F(" V"));
+      Serial.print(F("Solar Voltage = "));
+      Serial.print(v_solar, 3);
+      Serial.println(F(" V"));
+      Serial.println(F("-----------------------------------"));
       cur_cal_state = USER_BAT;
-      Serial.println("Take a DMM, Measure the Battery Voltage, Type it here and press Enter:");
-      Serial.println("**NOTE: Backspace doesn't work, make sure to type in perfectly or cycle power**");
+      Serial.println(F("Take a DMM, Measure the Battery Voltage, Type it here and press Enter:"));
+      Serial.println(F("**NOTE: Backspace doesn't work, make sure to type in perfectly or cycle power**"));
       inbyte_i = 0;
       // Init battery average
       avg_bat = v_battery;
@@ -145,7 +145,7 @@ void calibration_state_machine() {
       avg_bat += v_battery;
       avg_bat /= 2;
       // Read User Input
-      if (Serial.available() > 0 && inbyte_i < 100) {
+      if (Serial.available() > 0 && inbyte_i < CAL_LINE) {
         // read character
         inbytes[inbyte_i] = Serial.read();
         // echo character
@@ -156,9 +156,9 @@ void calibration_state_machine() {
           // Convert inbytes to float, size inbyte_i
           user_bat = atof(inbytes);
           cur_cal_state = USER_SOL;
-          Serial.println("-----------------------------------");
-          Serial.println("Take a DMM, Measure the Solar Voltage, Type it here and press Enter:");
-          Serial.println("**NOTE: Backspace doesn't work, make sure to type in perfectly or cycle power**");
+          Serial.println(F("-----------------------------------"));
+          Serial.println(F("Take a DMM, Measure the Solar Voltage, Type it here and press Enter:"));
+          Serial.println(F("**NOTE: Backspace doesn't work, make sure to type in perfectly or cycle power**"));
           // Reset inbyte index
           inbyte_i = 0;
           // take fresh solar measurement
@@ -179,7 +179,7 @@ void calibration_state_machine() {
       avg_sol += v_solar;
       avg_sol /= 2;
       // Read User Input
-      if (Serial.available() > 0 && inbyte_i < 100) {
+      if (Serial.available() > 0 && inbyte_i < CAL_LINE) {
         // read character
         inbytes[inbyte_i] = Serial.read();
         // echo character
@@ -200,24 +200,28 @@ void calibration_state_machine() {
     // Calculates errors and corrected VBAT and VSOL COEFs
     ////////////////////////////////////////////////////////////////////////
     case CALC:
-      Serial.println("-----------------------------------");
+      Serial.println(F("-----------------------------------"));
       // Calculate and report measurement errors
-      sprintf(tempstr, "Battery Voltage Measurement Error = %f percent", 100 * (ABS(user_bat - avg_bat) / (user_bat)));
-      Serial.println(tempstr);
-      sprintf(tempstr, "Solar Voltage Measurement Error = %f percent", 100 * (ABS(user_sol - avg_sol) / (user_sol)));
-      Serial.println(tempstr);
+      Serial.print(F("Battery Voltage Measurement Error = "));
+      Serial.print(100 * (ABS(user_bat - avg_bat) / (user_bat)), 2);
+      Serial.println(F(" percent"));
+      Serial.print(F("Solar Voltage Measurement Error = "));
+      Serial.print(100 * (ABS(user_sol - avg_sol) / (user_sol)), 2);
+      Serial.println(F(" percent"));
       // Calculate and report correct coeffs for user to re-run with
-      sprintf(tempstr, "#define VBAT_COEF (%e)", (user_bat / avg_bat)*VBAT_COEF);
-      Serial.println(tempstr);
-      sprintf(tempstr, "#define VSOL_COEF (%e)", (user_sol / avg_sol)*VSOL_COEF);
-      Serial.println(tempstr);
-      Serial.println("-----------------------------------");
-      Serial.println("Replace #defines in config.h to match these above and recompile and download again");
-      Serial.println("Recommend repeating this process until voltage measurement errors fall below 1%");
-      Serial.println("Once fully satisified with errors comment out the \"#define CAL 1\" line in config.h");
-      Serial.println("-----------------------------------");
-      Serial.println("Calibration Complete");
-      Serial.println("-----------------------------------");
+      Serial.print(F("#define VBAT_COEF ("));
+      Serial.print((user_bat / avg_bat)*VBAT_COEF, 8);
+      Serial.println(F(")"));
+      Serial.print(F("#define VSOL_COEF ("));
+      Serial.print((user_sol / avg_sol)*VSOL_COEF, 8);
+      Serial.println(F(")"));
+      Serial.println(F("-----------------------------------"));
+      Serial.println(F("Replace #defines in config.h to match these above and recompile and download again"));
+      Serial.println(F("Recommend repeating this process until voltage measurement errors fall below 1%"));
+      Serial.println(F("Once fully satisified with errors comment out the \"#define CAL 1\" line in config.h"));
+      Serial.println(F("-----------------------------------"));
+      Serial.println(F("Calibration Complete"));
+      Serial.println(F("-----------------------------------"));
       // Set state to DONE
       cur_cal_state = DONE_CAL;
       break;
@@ -231,12 +235,13 @@ void calibration_state_machine() {
       // End calibration
       calibrating = 0;
       // Printout Self Test
-      Serial.println("Begging Self Test Report of Solar Charger");
-      Serial.println("-----------------------------------");
-      sprintf(tempstr, "Running %d Number of Tests", N_MPPT);
-      Serial.println(tempstr);
-      Serial.println("Values are CSV as follows:");
-      Serial.println("v_battery, v_solar, integral_avg, p_cur, duty_cycle, time");
+      Serial.println(F("Begging Self Test Report of Solar Charger"));
+      Serial.println(F("-----------------------------------"));
+      Serial.print(F("Running "));
+      Serial.print(N_MPPT);
+      Serial.println(F(" Number of Tests"));
+      Serial.println(F("Values are CSV as follows:"));
+      Serial.println(F("v_battery, v_solar, integral_avg, p_cur, duty_cycle, time"));
       break;
 
   }
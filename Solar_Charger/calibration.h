@@ -30,14 +30,12 @@
 // Config Header
 #include "config.h"
 #ifdef CAL
-#include <string.h>
 #include <stdlib.h>
-#include <stdio.h>
 
 ////////////////////////////////////////////////////////////////////////
 // Type Definitions
 ////////////////////////////////////////////////////////////////////////
-typedef enum _cal_states {INIT_CAL, MEAS, USER_BAT, USER_SOL, CALC, DONE_CAL} CAL_STATES;
+typedef enum _cal_states : unsigned char {INIT_CAL, MEAS, USER_BAT, USER_SOL, CALC, DONE_CAL} CAL_STATES;
 
 ////////////////////////////////////////////////////////////////////////
 // Global Variables
@@ -45,13 +43,12 @@ typedef enum _cal_states {INIT_CAL, MEAS, USER_BAT, USER_SOL, CALC, DONE_CAL} CA
 extern volatile double user_bat, user_sol;
 extern volatile CAL_STATES cur_cal_state;
 extern char inbyte;
-extern char inbytes[100];
-extern char inbyte_i;
-extern char tempstr[100];
+extern char inbytes[CAL_LINE];
+extern unsigned char inbyte_i;
 extern bool calibrating;
 extern double avg_bat;
 extern double avg_sol;
-extern int n_mppt;
+extern unsigned char n_mppt;
 
 ////////////////////////////////////////////////////////////////////////
 // Function Prototypes
@@ -62,6 +59,6 @@ extern void calibration_state_machine();
 ////////////////////////////////////////////////////////////////////////
 // Macros
 ////////////////////////////////////////////////////////////////////////
-#define ABS(X) ((X>0)?(X):(-X))
+#define ABS(X) (((X)>0)?(X):(-(X)))
 
 #endif
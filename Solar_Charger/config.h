@@ -39,8 +39,10 @@
 //#define CAL 1
 ////////////////////////////////////////////////////////////////////////
 #ifdef CAL
-// Number of MPPTs to run during self test report (100 ~= 33s)
+// Number of MPPTs to run during self test report (100 ~= 33s, max 255)
 #define N_MPPT 100
+// Input Line Buffer Size for typed DMM readings (bytes)
+#define CAL_LINE 16
 
 #endif
 
@@ -50,8 +52,11 @@
 // After running calibration sequence and saving off the log, modify
 // the VBAT_COEF and VSOL_COEF below to match the log.
 ////////////////////////////////////////////////////////////////////////
+// ADC Full Scale Code (10 bit ADC)
+#define ADC_MAX ((1<<10)-1)
 // ADC COEF (V/code) 10 bit ADC 3.3V Reference
-#define ADC_COEF (3.3/(2^(11)-1))
+// (was 3.3/(2^(11)-1), 2^11 is XOR in C so that read 128x high)
+#define ADC_COEF (3.3/ADC_MAX)
 // Inductor Voltage ADC Gain Coef
 #define VL_COEF (1/(0.0990991))
 // Inductor Voltage ADC Offset
@@ -98,5 +103,201 @@
 #define D_MAX 98
 // Sleep Time (5m)
 #define SLEEP_TIME (5*60)
-// Base Timer Frequency (100xPWM Frequency)
-#define BASE_PER (1/(100*PWM_FREQ))
+// Base Timer Period (s) for a PWM Frequency F (100xPWM Frequency)
+#define BASE_PER(F) (1.0/(100.0*(F)))
+
+////////////////////////////////////////////////////////////////////////
+// Power Stage
+////////////////////////////////////////////////////////////////////////
+// Measure your build, the ripple tracker and the overcurrent estimate
+// turn the VL integral into amps with these
+////////////////////////////////////////////////////////////////////////
+// Inductance (H)
+#define IND_L 5e-3
+// Inductor Winding Resistance (Ohm, inside the VL sense)
+#define IND_R 0.2
+// Input (panel) Capacitance (F)
+#define CAP_IN 2200e-6
+
+////////////////////////////////////////////////////////////////////////
+// MPPT Algorithm Settings
+////////////////////////////////////////////////////////////////////////
+// The default tracker is perturb and observe, one 1% duty step every
+// NUM_INT periods. Uncomment "#define MPPT_RCC 1" for ripple
+// correlation control instead: every period it correlates the panel
+// voltage and power ripple across the on-time samples (dP/dV) and moves
+// the duty cycle toward the MPP. Needs SYNC_SAMPLE, and the Power Stage
+// values above set to your inductor and input capacitor.
+// Uncomment "#define MPPT_KF 1" to keep P&O but decide from a Kalman
+// estimate of the power (level and trend per period) instead of the
+// NUM_INT average: it steps as soon as the change since the last step
+// is KF_SIGMA standard deviations clear of the noise (corrected for the
+// trend), NUM_INT becomes the most periods it waits.
+// With MPPT_SETTLE perturb and observe steps as soon as the period
+// power has stopped moving after the last step (SETTLE_N periods in a
+// row within SETTLE_TOL), no sooner than MIN_INT and no later than
+// NUM_INT periods. Use one of MPPT_KF and MPPT_SETTLE, both decide
+// when to step.
+////////////////////////////////////////////////////////////////////////
+//#define MPPT_RCC 1
+//#define MPPT_KF 1
+//#define MPPT_SETTLE 1
+////////////////////////////////////////////////////////////////////////
+#ifdef MPPT_RCC
+// Duty Cycle Gain (% per period at full scale normalized dP/dV)
+#define RCC_GAIN 10.0
+#ifdef MPPT_KF
+#error "MPPT_KF is for perturb and observe, not MPPT_RCC"
+#endif
+#endif
+#ifdef MPPT_KF
+// Power Random Walk per Period (fraction of power, std dev)
+#define KF_Q_P 0.002
+// Power Trend Random Walk per Period (fraction of power, std dev)
+#define KF_Q_D 0.0005
+// Starting and Minimum Measurement Noise (fraction of power, std dev)
+#define KF_R0 0.05
+#define KF_R_MIN 0.002
+// Measurement Noise Floor (std dev in V * V*us, a tenth of a VL code
+// over a 16ms on-time at 12V), keeps the noise positive at zero power
+#define KF_R_FLOOR 600.0
+// Periods to adapt the Measurement Noise over
+#define KF_R_N 16
+// Step once the change is this many Standard Deviations
+#define KF_SIGMA 1.0
+// Periods ignored after a Step (input cap settling)
+#define KF_SKIP 0
+// Measurements per Step, the second one onward updates the trend
+#define KF_MIN_N 1
+#endif
+#ifdef MPPT_SETTLE
+#ifdef MPPT_RCC
+#error "MPPT_SETTLE is for perturb and observe, not MPPT_RCC"
+#endif
+#ifdef MPPT_KF
+#error "MPPT_SETTLE and MPPT_KF both decide when to step, use one"
+#endif
+// Fewest Periods between Steps (NUM_INT is the most)
+#define MIN_INT 2
+// Settled when the period power moves less than this fraction
+#define SETTLE_TOL 0.02
+// for this many periods in a row
+#define SETTLE_N 2
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// Inductor Sampling Settings
+////////////////////////////////////////////////////////////////////////
+// With SYNC_SAMPLE the timer interrupt switches SW1 and takes N_SAMPLES
+// equally spaced VL conversions in each on-time, skipping the first
+// BLANK_TICKS (1% of the period each) of switching transient. Comment
+// out "#define SYNC_SAMPLE 1" to sample VL from the main loop instead.
+////////////////////////////////////////////////////////////////////////
+#define SYNC_SAMPLE 1
+////////////////////////////////////////////////////////////////////////
+#ifdef SYNC_SAMPLE
+// Number of VL Samples per On-Time (RCC fits a slope through them)
+#ifdef MPPT_RCC
+#define N_SAMPLES 8
+#else
+#define N_SAMPLES 4
+#endif
+// Blanking Ticks after SW1 Turns On
+#define BLANK_TICKS 2
+#ifdef MPPT_RCC
+// Maximum PWM Frequency (each sample tick holds two ~112us conversions)
+#define PWM_FREQ_MAX 40
+#else
+// Maximum PWM Frequency (each sample tick holds a ~112us conversion)
+#define PWM_FREQ_MAX 60
+#endif
+#else
+#ifdef MPPT_RCC
+#error "MPPT_RCC needs SYNC_SAMPLE"
+#endif
+// Maximum PWM Frequency (relay limit)
+#define PWM_FREQ_MAX 200
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// Protection Settings
+////////////////////////////////////////////////////////////////////////
+// With PROTECT the timer interrupt checks the battery voltage and an
+// inductor current estimate every tick (1% of the period), forces SW1
+// off and latches a fault code. The charger then stays off until the
+// console "clear" command or a power cycle. Needs SYNC_SAMPLE.
+// Load budget (16MHz, simulator model): a conversion takes 112us, so
+// protect() never waits on one. It reads back the conversion it started
+// the tick before and starts the next, about 4us a tick. Only the
+// N_SAMPLES sample ticks convert in the interrupt (114us, 226us with
+// MPPT_RCC), 2.5% of the CPU at 30Hz and 5% at 60Hz (6.5% and 8.7% at
+// 30 and 40Hz with MPPT_RCC). The longest the interrupt holds off the
+// UART is that one sample tick, under the 3 bytes (260us) the USART
+// buffers at 115200 baud, and adc_read() in the main loop masks one
+// conversion at most.
+////////////////////////////////////////////////////////////////////////
+#define PROTECT 1
+////////////////////////////////////////////////////////////////////////
+#ifdef PROTECT
+#ifndef SYNC_SAMPLE
+#error "PROTECT needs SYNC_SAMPLE"
+#endif
+// Battery Over-Voltage Trip (V)
+#define PROT_VBAT_MAX 15.5
+// Battery Under-Voltage Trip (V, battery missing or shorted cells)
+#define PROT_VBAT_MIN 10.0
+// Own Conversions per VBAT reading, the rest read VL
+#define PROT_VBAT_EVERY 3
+// Inductor Over-Current Trip (A, estimated from the VL integral)
+#define PROT_IL_MAX 12.0
+// VL Noise Band (ADC codes), inside it around 0V the inductor is empty
+#define PROT_VL_NOISE 8
+// ADC Stuck Trip, VL swings less than the noise band over
+// PROT_STUCK_PER periods in a row while SW1 switches
+#define PROT_STUCK_PER 3
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// Console Settings
+////////////////////////////////////////////////////////////////////////
+// The charger settings above are only defaults, the serial console
+// can get/set them at runtime and save them to EEPROM. Comment out
+// "#define CONSOLE 1" to build without the console.
+////////////////////////////////////////////////////////////////////////
+#define CONSOLE 1
+////////////////////////////////////////////////////////////////////////
+#ifdef CONSOLE
+// Console Baud Rate
+#define CONSOLE_BAUD 115200
+// Console Line Buffer Size (bytes)
+#define CONSOLE_LINE 32
+// EEPROM Address of Saved Settings
+#define CONSOLE_EE_ADDR 0
+// EEPROM Magic Byte (change when SETTINGS layout changes)
+#ifdef MPPT_SETTLE
+#define CONSOLE_EE_MAGIC 0xA6
+#else
+#define CONSOLE_EE_MAGIC 0xA5
+#endif
+
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// Benchmark Settings
+////////////////////////////////////////////////////////////////////////
+// Uncomment "#define BENCH 1" (or let bench.sh build with -DBENCH) to
+// turn the firmware into a benchmark of its hot paths: setup() times
+// each one with Timer1 as a cycle counter, prints a CSV over Serial and
+// the charger never starts.
+////////////////////////////////////////////////////////////////////////
+//#define BENCH 1
+////////////////////////////////////////////////////////////////////////
+#ifdef BENCH
+// Serial Baud Rate
+#define BENCH_BAUD 115200
+// Timed Calls per Case (averaged)
+#define BENCH_CALLS 64
+// Duty Cycle (%) for the samples per On-Time estimate
+#define BENCH_DUTY 50
+
+#endif
@@ -0,0 +1,412 @@
+////////////////////////////////////////////////////////////////////////
+// console.cpp
+// Serial Command Console Source File
+// by: Aistheta Gleason
+////////////////////////////////////////////////////////////////////////
+// Safety Note: Read the README!!! Keep Battery in well ventilated area
+////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////
+// Copyright and License
+////////////////////////////////////////////////////////////////////////
+// Copyright 2022, Aistheta (Adam) Gleason
+////////////////////////////////////////////////////////////////////////
+// This program is free software: you can redistribute it and/or modify 
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or 
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// (LICENSE) along with this program. If not, see 
+// https://www.gnu.org/licenses/
+////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////
+// Load Config
+#include "config.h"
+#ifdef CONSOLE
+// MPPT Library
+#include "mppt.h"
+// Console Library
+#include "console.h"
+// EEPROM Library
+#include <EEPROM.h>
+#include <string.h>
+#include <stdlib.h>
+
+////////////////////////////////////////////////////////////////////////
+// Global Variables
+////////////////////////////////////////////////////////////////////////
+// Console Line Buffer
+char line[CONSOLE_LINE];
+// Console Line Buffer Index
+unsigned char line_i;
+// Line Overflowed Flag (discard until newline)
+bool line_overflow;
+// Parameter Names (flash)
+const char name_vcharge[] PROGMEM = "vcharge";
+const char name_num_int[] PROGMEM = "num_int";
+#ifdef MPPT_SETTLE
+const char name_min_int[] PROGMEM = "min_int";
+#endif
+const char name_d_min[] PROGMEM = "d_min";
+const char name_d_max[] PROGMEM = "d_max";
+const char name_pwm_freq[] PROGMEM = "pwm_freq";
+const char name_sleep_time[] PROGMEM = "sleep_time";
+// Parameter Table (flash, ranges keep the converter and relay in safe limits)
+const PARAM params[] PROGMEM = {
+  {name_vcharge, P_DOUBLE, &settings.vcharge, 10.0, 15.0},
+  {name_num_int, P_UCHAR, &settings.num_int, 1, 100},
+#ifdef MPPT_SETTLE
+  {name_min_int, P_UCHAR, &settings.min_int, 1, 100},
+#endif
+  {name_d_min, P_UCHAR, &settings.d_min, 1, 97},
+  {name_d_max, P_UCHAR, &settings.d_max, 2, 98},
+  {name_pwm_freq, P_UINT, &settings.pwm_freq, 1, PWM_FREQ_MAX},
+  {name_sleep_time, P_UINT, &settings.sleep_time, 10, 3600},
+};
+// Number of Parameters
+#define N_PARAMS (sizeof(params) / sizeof(params[0]))
+
+////////////////////////////////////////////////////////////////////////
+// Functions
+////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////
+// get_param() function
+// Reads a parameter as a double
+////////////////////////////////////////////////////////////////////////
+double get_param(PARAM *p) {
+  switch (p->type) {
+    case P_DOUBLE:
+      return *(double *) p->value;
+    case P_UCHAR:
+      return *(unsigned char *) p->value;
+    case P_UINT:
+      return *(unsigned int *) p->value;
+  }
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// put_param() function
+// Writes a parameter from a double (range already checked)
+////////////////////////////////////////////////////////////////////////
+void put_param(PARAM *p, double val) {
+  switch (p->type) {
+    case P_DOUBLE:
+      *(double *) p->value = val;
+      break;
+    case P_UCHAR:
+      *(unsigned char *) p->value = (unsigned char) val;
+      break;
+    case P_UINT:
+      *(unsigned int *) p->value = (unsigned int) val;
+      break;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// load_param() function
+// Copies parameter table entry i out of flash
+////////////////////////////////////////////////////////////////////////
+void load_param(unsigned char i, PARAM *p) {
+  memcpy_P(p, &params[i], sizeof(PARAM));
+}
+
+////////////////////////////////////////////////////////////////////////
+// find_param() function
+// Looks up a parameter by name into p, returns 0 if not found
+////////////////////////////////////////////////////////////////////////
+bool find_param(const char *name, PARAM *p) {
+  for (unsigned char i = 0; i < N_PARAMS; i++) {
+    load_param(i, p);
+    if (strcmp_P(name, p->name) == 0) return 1;
+  }
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// settings_valid() function
+// Checks every parameter is in range and the duty limits are ordered
+////////////////////////////////////////////////////////////////////////
+bool settings_valid() {
+  PARAM p;
+  double val;
+  for (unsigned char i = 0; i < N_PARAMS; i++) {
+    load_param(i, &p);
+    val = get_param(&p);
+    if (!(val >= p.min_val && val <= p.max_val)) return 0;
+  }
+#ifdef MPPT_SETTLE
+  if (settings.min_int > settings.num_int) return 0;
+#endif
+  return settings.d_min < settings.d_max;
+}
+
+////////////////////////////////////////////////////////////////////////
+// print_param() function
+// Prints "name=value"
+////////////////////////////////////////////////////////////////////////
+void print_param(PARAM *p) {
+  Serial.print((const __FlashStringHelper *) p->name);
+  Serial.print(F("="));
+  if (p->type == P_DOUBLE) Serial.println(get_param(p), 2);
+  else Serial.println((unsigned int) get_param(p));
+}
+
+////////////////////////////////////////////////////////////////////////
+// cmd_get() function
+// get [name], prints one or all parameters
+////////////////////////////////////////////////////////////////////////
+void cmd_get(char *name) {
+  PARAM p;
+  if (name == 0) {
+    for (unsigned char i = 0; i < N_PARAMS; i++) {
+      load_param(i, &p);
+      print_param(&p);
+    }
+  } else if (find_param(name, &p)) {
+    print_param(&p);
+  } else {
+    Serial.println(F("ERR unknown parameter"));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// cmd_set() function
+// set name value, range checks then applies to the running charger
+////////////////////////////////////////////////////////////////////////
+void cmd_set(char *name, char *arg) {
+  PARAM param, *p = &param;
+  double val, old_val;
+  if (name == 0 || arg == 0) {
+    Serial.println(F("ERR usage: set name value"));
+    return;
+  }
+  if (!find_param(name, p)) {
+    Serial.println(F("ERR unknown parameter"));
+    return;
+  }
+  val = atof(arg);
+  // Range Check (written so NaN and inf fail it too)
+  if (!(val >= p->min_val && val <= p->max_val)) {
+    Serial.print(F("ERR range "));
+    Serial.print(p->min_val, 2);
+    Serial.print(F("-"));
+    Serial.println(p->max_val, 2);
+    return;
+  }
+  // Set, then back out if the duty limits crossed
+  old_val = get_param(p);
+  put_param(p, val);
+  if (settings.d_min >= settings.d_max) {
+    put_param(p, old_val);
+    Serial.println(F("ERR d_min must be below d_max"));
+    return;
+  }
+#ifdef MPPT_SETTLE
+  if (settings.min_int > settings.num_int) {
+    put_param(p, old_val);
+    Serial.println(F("ERR min_int must not be above num_int"));
+    return;
+  }
+#endif
+  // Apply to running charger
+  apply_settings();
+  print_param(p);
+}
+
+////////////////////////////////////////////////////////////////////////
+// cmd_save() function
+// Saves the settings to EEPROM (loaded by setup_console on boot)
+////////////////////////////////////////////////////////////////////////
+void cmd_save() {
+  EEPROM.write(CONSOLE_EE_ADDR, CONSOLE_EE_MAGIC);
+  EEPROM.put(CONSOLE_EE_ADDR + 1, settings);
+  Serial.println(F("OK saved"));
+}
+
+////////////////////////////////////////////////////////////////////////
+// cmd_defaults() function
+// Restores the config.h defaults (save to make permanent)
+////////////////////////////////////////////////////////////////////////
+void cmd_defaults() {
+  default_settings();
+  apply_settings();
+  Serial.println(F("OK defaults"));
+}
+
+#ifdef __AVR__
+////////////////////////////////////////////////////////////////////////
+// free_ram() function
+// Bytes between the top of the heap and the stack pointer
+////////////////////////////////////////////////////////////////////////
+int free_ram() {
+  extern int __heap_start, *__brkval;
+  int top;
+  return (int) &top - (__brkval == 0 ? (int) &__heap_start : (int) __brkval);
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// cmd_stats() function
+// Prints the live charger state
+////////////////////////////////////////////////////////////////////////
+void cmd_stats() {
+  Serial.print(F("state="));
+  Serial.println(cur_state);
+  Serial.print(F("duty_cycle="));
+  Serial.println(duty_cycle);
+  Serial.print(F("v_solar="));
+  Serial.println(v_solar, 2);
+  Serial.print(F("v_battery="));
+  Serial.println(v_battery, 2);
+  Serial.print(F("integral_avg="));
+  Serial.println(integral_avg);
+  Serial.print(F("p_cur="));
+  Serial.println(p_cur, 0);
+  Serial.print(F("p_w="));
+  Serial.println(battery_power(), 2);
+#ifdef MPPT_KF
+  Serial.print(F("kf_p="));
+  Serial.println(kf_p, 0);
+  Serial.print(F("kf_dp="));
+  Serial.println(kf_dp, 1);
+  Serial.print(F("kf_conf="));
+  Serial.println(kf_conf, 2);
+#endif
+  Serial.print(F("uptime="));
+  Serial.println(millis());
+#ifdef PROTECT
+  // Latched Fault (0 none, 1 over-voltage, 2 under-voltage, 3 over-current, 4 ADC stuck)
+  Serial.print(F("fault="));
+  Serial.println(fault);
+#endif
+#ifdef __AVR__
+  // Free RAM between heap and stack (headroom on the 2KB part)
+  Serial.print(F("free_ram="));
+  Serial.println(free_ram());
+#endif
+}
+
+#ifdef PROTECT
+////////////////////////////////////////////////////////////////////////
+// cmd_clear() function
+// Clears a latched fault, done_charging() then restarts the charger
+////////////////////////////////////////////////////////////////////////
+void cmd_clear() {
+  fault = F_NONE;
+  Serial.println(F("OK clear"));
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// cmd_telemetry() function
+// One line status for fleet polling (Fleet/fleet.cpp), fixed order:
+// T,uptime_ms,state,fault,duty_cycle,v_solar_mV,v_battery_mV,p_mW
+////////////////////////////////////////////////////////////////////////
+void cmd_telemetry() {
+  Serial.print(F("T,"));
+  Serial.print(millis());
+  Serial.print(F(","));
+  Serial.print(cur_state);
+  Serial.print(F(","));
+#ifdef PROTECT
+  Serial.print(fault);
+#else
+  Serial.print(0);
+#endif
+  Serial.print(F(","));
+  Serial.print(duty_cycle);
+  Serial.print(F(","));
+  Serial.print((long) (v_solar * 1000));
+  Serial.print(F(","));
+  Serial.print((long) (v_battery * 1000));
+  Serial.print(F(","));
+  Serial.println((long) (battery_power() * 1000));
+}
+
+////////////////////////////////////////////////////////////////////////
+// run_command() function
+// Splits a line into words and runs the command
+////////////////////////////////////////////////////////////////////////
+void run_command(char *cmd) {
+  char *arg1, *arg2;
+  cmd = strtok(cmd, " \t");
+  // Blank Line
+  if (cmd == 0) return;
+  arg1 = strtok(0, " \t");
+  arg2 = strtok(0, " \t");
+  if (strcmp_P(cmd, PSTR("get")) == 0) cmd_get(arg1);
+  else if (strcmp_P(cmd, PSTR("set")) == 0) cmd_set(arg1, arg2);
+  else if (strcmp_P(cmd, PSTR("save")) == 0) cmd_save();
+  else if (strcmp_P(cmd, PSTR("defaults")) == 0) cmd_defaults();
+  else if (strcmp_P(cmd, PSTR("stats")) == 0) cmd_stats();
+  else if (strcmp_P(cmd, PSTR("t")) == 0) cmd_telemetry();
+#ifdef PROTECT
+  else if (strcmp_P(cmd, PSTR("clear")) == 0) cmd_clear();
+  else Serial.println(F("ERR commands: get [name], set name value, save, defaults, stats, t, clear"));
+#else
+  else Serial.println(F("ERR commands: get [name], set name value, save, defaults, stats, t"));
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////
+// setup_console() function
+// Starts Serial and loads saved settings from EEPROM if valid
+////////////////////////////////////////////////////////////////////////
+void setup_console() {
+#ifndef CAL
+  // Start Serial (calibration starts it when CAL)
+  Serial.begin(CONSOLE_BAUD);
+#endif
+  // Reset Line Buffer
+  line_i = 0;
+  line_overflow = 0;
+  // Load Saved Settings
+  if (EEPROM.read(CONSOLE_EE_ADDR) == CONSOLE_EE_MAGIC) {
+    EEPROM.get(CONSOLE_EE_ADDR + 1, settings);
+    // Fall back to defaults if corrupt
+    if (!settings_valid()) default_settings();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// console_poll() function
+// Non-blocking, buffers whatever bytes are waiting and runs a command
+// once a full line is in, called from loop() outside the control path
+////////////////////////////////////////////////////////////////////////
+void console_poll() {
+  char c;
+#ifdef CAL
+  // Calibration owns Serial until it is done
+  if (calibrating) return;
+#endif
+  while (Serial.available() > 0) {
+    c = Serial.read();
+    // End of Line
+    if (c == '\n' || c == '\r') {
+      if (line_overflow) {
+        Serial.println(F("ERR line too long"));
+      } else {
+        line[line_i] = 0;
+        run_command(line);
+      }
+      line_i = 0;
+      line_overflow = 0;
+      // One command per poll, keep the loop moving
+      return;
+    }
+    // Buffer Character (leave room for terminator)
+    if (line_i < CONSOLE_LINE - 1) line[line_i++] = c;
+    else line_overflow = 1;
+  }
+}
+// ifdef CONSOLE
+#endif
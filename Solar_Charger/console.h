@@ -0,0 +1,57 @@
+////////////////////////////////////////////////////////////////////////
+// console.h
+// Serial Command Console Header File
+// by: Aistheta Gleason
+////////////////////////////////////////////////////////////////////////
+// Safety Note: Read the README!!! Keep Battery in well ventilated area
+////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////
+// Copyright and License
+////////////////////////////////////////////////////////////////////////
+// Copyright 2022, Aistheta (Adam) Gleason
+////////////////////////////////////////////////////////////////////////
+// This program is free software: you can redistribute it and/or modify 
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or 
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// (LICENSE) along with this program. If not, see 
+// https://www.gnu.org/licenses/
+////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////
+// Includes
+////////////////////////////////////////////////////////////////////////
+// Config Header
+#include "config.h"
+#ifdef CONSOLE
+
+////////////////////////////////////////////////////////////////////////
+// Type Definitions
+////////////////////////////////////////////////////////////////////////
+// Console Parameter Type Definition
+typedef enum _param_types : unsigned char {P_DOUBLE, P_UCHAR, P_UINT} PARAM_TYPES;
+// Console Parameter Table Entry
+typedef struct _param {
+  // Name typed at the console
+  const char *name;
+  // Type of the setting it points at
+  PARAM_TYPES type;
+  // Pointer into settings
+  void *value;
+  // Allowed Range (inclusive)
+  double min_val, max_val;
+} PARAM;
+
+////////////////////////////////////////////////////////////////////////
+// Function Prototypes
+////////////////////////////////////////////////////////////////////////
+extern void setup_console();
+extern void console_poll();
+
+#endif
@@ -33,6 +33,10 @@
 #include <TimerOne.h>
 // Config Library
 #include "config.h"
+#ifdef CONSOLE
+// Console Library
+#include "console.h"
+#endif
 
 
 ////////////////////////////////////////////////////////////////////////
@@ -40,18 +44,24 @@
 ////////////////////////////////////////////////////////////////////////
 // State Variable Definition
 volatile STATES cur_state;
+// Charger Settings
+SETTINGS settings;
 // Duty Cycle Variable
 volatile unsigned char duty_cycle;
 // Solar and Battery Voltage Variables
 volatile double v_solar, v_battery;
+#ifndef SYNC_SAMPLE
 // Inductor Current and Previous Voltage Variables
 volatile double vl_cur, vl_prev;
+#endif
 // MPPT Power Tracking Variables (for slopes)
 volatile double p_cur, p_prev;
 // Integral Variable
 volatile long int integral;
+#ifndef SYNC_SAMPLE
 // Time Tracking Variables (for dt integration)
 volatile unsigned long int t_cur, t_prev;
+#endif
 // Number of Integrations
 volatile unsigned char num_integrals;
 // Average Integral Value (over NUM_INT integrals)
@@ -60,6 +70,81 @@ volatile long int integral_avg;
 volatile unsigned char pwm_count;
 // New Integral Flag, Timer On Flag, and Duty Cycle Increase Flag
 volatile bool new_integral, timer_on, duty_inc;
+#ifdef SYNC_SAMPLE
+// VL Samples (ADC codes), pwm_handler fills one buffer while mppt()
+// reads the other
+volatile int vl_samples[2][N_SAMPLES];
+// Buffer being filled, Number of Samples Taken and Next Sample Tick
+volatile unsigned char sample_buf, n_samples, sample_tick;
+// Ticks between Samples and Duty Cycle the Samples were taken at
+volatile unsigned char sample_step, sample_duty;
+// Last finished On-Time: its Buffer, Sample Count, Step and Duty Cycle
+volatile unsigned char ready_buf, ready_n, ready_step, ready_duty;
+// Copy of the last finished On-Time for mppt() (take_samples())
+int snap_vl[N_SAMPLES];
+unsigned char snap_n, snap_step, snap_duty;
+// SW1 On Flag (set by pwm_handler)
+volatile bool sw_on;
+#endif
+#ifdef MPPT_RCC
+// Solar Voltage Samples (ADC codes), buffered like vl_samples
+volatile int vsol_samples[2][N_SAMPLES];
+// Copy of the last finished On-Time (take_samples())
+int snap_vsol[N_SAMPLES];
+// Solar Voltage (ADC code) at the end of the Off-Time
+volatile int vsol_rest;
+// Fractional Duty Cycle (%) the tracker integrates
+double rcc_duty;
+#endif
+#ifdef MPPT_KF
+// Filtered Power and its Trend (per period)
+double kf_p, kf_dp;
+// Estimate Covariance (level, level-trend, trend)
+double kf_pp, kf_pd, kf_dd;
+// Measurement Noise Variance (adapted)
+double kf_r;
+// Power Level and its Variance when the last Step was taken
+double kf_p_step, kf_var_step;
+// Standard Deviations the last Step was decided on
+double kf_conf;
+// Level known since the last Step
+bool kf_known;
+// Measurements since the last Step
+unsigned char kf_n;
+#endif
+#ifdef MPPT_SETTLE
+// Last Period's Integral and Periods in a row it settled
+long settle_last;
+unsigned char settle_cnt;
+#endif
+#ifdef PROTECT
+// Latched Fault Code (F_NONE while running)
+volatile FAULTS fault;
+// Inductor Current Estimate and its Trip Level (VL codes summed per tick)
+volatile long prot_il, prot_il_max;
+// Winding Drop per Tick (Q16)
+volatile long prot_il_decay;
+// Last VBAT Conversion (ADC code)
+volatile int prot_vbat;
+// Last VL (ADC code, can read past full scale) and its Min/Max over the Period
+volatile int prot_vl, prot_vl_min, prot_vl_max;
+// Last Code off the VL pin itself (not from VSOL), for the stuck check
+volatile int prot_vl_pin;
+// Periods in a Row VL did not move
+volatile unsigned char prot_stuck;
+// Conversion already taken this Tick
+volatile bool prot_read;
+// Own Conversions, every PROT_VBAT_EVERY-th one is VBAT
+volatile unsigned char prot_n;
+// Pin of the own Conversion still to be read back (0 = none), and a
+// VBAT code read back that protect() hasn't checked yet
+volatile unsigned char prot_pend;
+volatile bool prot_vbat_new;
+// SW1 was on when the own Conversion started, and when prot_vl was taken
+volatile bool prot_pend_sw, prot_vl_sw;
+// VL went past the sense range this On-Time, and the last one
+volatile bool prot_clip, prot_clip_last;
+#endif
 
 
 ////////////////////////////////////////////////////////////////////////
@@ -68,6 +153,130 @@ volatile bool new_integral, timer_on, duty_inc;
 // Built in reset function
 void(* resetFunc) (void) = 0;
 
+////////////////////////////////////////////////////////////////////////
+// default_settings() function
+// Loads the charger settings with the config.h defaults
+////////////////////////////////////////////////////////////////////////
+void default_settings() {
+  settings.vcharge = VCHARGE;
+  settings.num_int = NUM_INT;
+#ifdef MPPT_SETTLE
+  settings.min_int = MIN_INT;
+#endif
+  settings.d_min = D_MIN;
+  settings.d_max = D_MAX;
+  settings.pwm_freq = PWM_FREQ;
+  settings.sleep_time = SLEEP_TIME;
+}
+
+////////////////////////////////////////////////////////////////////////
+// apply_settings() function
+// Applies changed settings to the running charger
+// Re-times the base timer and clamps the duty cycle to the new limits
+////////////////////////////////////////////////////////////////////////
+void apply_settings() {
+  // Re-time Base Timer to BASE_PER (us)
+  Timer1.setPeriod(BASE_PER(settings.pwm_freq) * 1e6);
+  // Clamp Duty Cycle to new Limits
+  if (duty_cycle > settings.d_max) duty_cycle = settings.d_max;
+  if (duty_cycle < settings.d_min) duty_cycle = settings.d_min;
+#ifdef PROTECT
+  // Over-Current Trip Level and Winding Drop scale with the tick length
+  // (longs protect() reads, held off so it can't see half a write)
+  noInterrupts();
+  prot_il_max = PROT_IL_CODES(settings.pwm_freq);
+  prot_il_decay = PROT_IL_DECAY(settings.pwm_freq);
+  interrupts();
+#endif
+}
+
+#ifdef PROTECT
+////////////////////////////////////////////////////////////////////////
+// adc_start(), adc_busy() and adc_result()
+// Conversion without waiting on it, for protect(). On the AVR it's what
+// analogRead() does split at the ADSC wait, the simulator models it.
+////////////////////////////////////////////////////////////////////////
+void adc_start(unsigned char pin) {
+#ifdef __AVR__
+  ADMUX = (DEFAULT << 6) | ((pin >= A0 ? pin - A0 : pin) & 0x07);
+  ADCSRA |= _BV(ADSC);
+#else
+  sim_adc_start(pin);
+#endif
+}
+
+bool adc_busy() {
+#ifdef __AVR__
+  return ADCSRA & _BV(ADSC);
+#else
+  return sim_adc_busy();
+#endif
+}
+
+int adc_result() {
+#ifdef __AVR__
+  return ADC;
+#else
+  return sim_adc_result();
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////
+// prot_collect()
+// Reads back protect()'s own conversion (waiting if it's still running)
+// into prot_vbat or prot_vl. Called before any other conversion, an
+// analogRead() started under it would return its code instead.
+////////////////////////////////////////////////////////////////////////
+void prot_collect() {
+  int code;
+  if (!prot_pend) return;
+  while (adc_busy());
+  code = adc_result();
+  if (prot_pend == VBAT_ADC) {
+    prot_vbat = code;
+    prot_vbat_new = 1;
+  } else {
+    // VL past the sense range, worked out as VSOL - VBAT
+    if (prot_pend == VSOL_ADC) prot_vl = VL_ZERO + ((code * PROT_VSOL_K - prot_vbat * PROT_VBAT_K) >> 16);
+    else prot_vl = prot_vl_pin = code;
+    prot_vl_sw = prot_pend_sw;
+    if (prot_vl_sw && prot_vl >= ADC_MAX) prot_clip = 1;
+  }
+  prot_pend = 0;
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// adc_read() function
+// Main loop analogRead, when pwm_handler() also converts it holds off
+// the timer interrupt so the two can't clobber each other's conversion
+// (with PROTECT it lets the interrupt in while protect()'s conversion
+// finishes, so it's masked for one conversion at most, and that one
+// starts right after a tick so the next tick isn't held back)
+////////////////////////////////////////////////////////////////////////
+int adc_read(unsigned char pin) {
+#ifdef SYNC_SAMPLE
+  int code;
+#ifdef PROTECT
+  // Wait out protect()'s conversion with the interrupt still on
+  for (;;) {
+    while (prot_pend && adc_busy());
+    noInterrupts();
+    if (!prot_pend || !adc_busy()) break;
+    interrupts();
+  }
+  prot_collect();
+#else
+  noInterrupts();
+#endif
+  code = analogRead(pin);
+  interrupts();
+  return code;
+#else
+  return analogRead(pin);
+#endif
+}
+
 ////////////////////////////////////////////////////////////////////////
 // check_battery() function
 // Checks the current battery level
@@ -77,7 +286,7 @@ void check_battery() {
   // Measure Battery Voltage
   v_battery = VBAT_MEAS;
   // If Battery Charged
-  if (v_battery >= VCHARGE) {
+  if (v_battery >= settings.vcharge) {
     timer_on = 0;
     cur_state = DONE_CHG;
   }
@@ -92,26 +301,201 @@ void check_solar() {
   v_solar = VSOL_MEAS;
 }
 
+////////////////////////////////////////////////////////////////////////
+// battery_power() function
+// Estimated charge power (W) from the averaged integral. The on-time
+// integral is L*Ipeak (DCM), the battery sees the triangle while SW1 is
+// on plus the inductor emptying (L*Ipeak^2/2 per period) after it.
+////////////////////////////////////////////////////////////////////////
+double battery_power() {
+  double i_peak;
+  if (cur_state == DONE_CHG || integral_avg <= 0) return 0;
+  i_peak = integral_avg * 1e-6 / IND_L;
+  return v_battery * i_peak * duty_cycle / 200.0 + IND_L * i_peak * i_peak * settings.pwm_freq / 2;
+}
+
+#ifdef PROTECT
+////////////////////////////////////////////////////////////////////////
+// prot_trip()
+// Forces SW1 off, stops the charger and latches the fault code
+////////////////////////////////////////////////////////////////////////
+void prot_trip(FAULTS code) {
+  digitalWrite(SW1_PWM, LOW);
+  sw_on = 0;
+  timer_on = 0;
+  fault = code;
+  cur_state = DONE_CHG;
+}
+
+////////////////////////////////////////////////////////////////////////
+// protect()
+// Fast path protection, runs at the end of every pwm_handler() tick so
+// a fault is caught within a few ticks instead of waiting for mppt().
+// Ticks that didn't already take a conversion read back the one started
+// the tick before and start the next, VL with every PROT_VBAT_EVERY-th
+// one VBAT, so the tick never waits on the ADC (a reading is one tick
+// old, and a tick shorter than a conversion skips). The inductor current
+// estimate sums the last VL reading less the winding drop every tick
+// (L*dIL/dt = VL - R*IL) and resets when the inductor empties. The VL sense clips at
+// about +8V, past that (or if it did last on-time) VL comes from VSOL -
+// VBAT instead. The stuck check only watches the VL pin itself.
+////////////////////////////////////////////////////////////////////////
+void protect() {
+  // Own Conversion, read back last tick's and start the next
+  if (!prot_read) {
+    if (prot_pend && !adc_busy()) prot_collect();
+    if (!prot_pend) {
+      // Mostly VL, VBAT every PROT_VBAT_EVERY (VL first once SW1 has
+      // switched, VBAT moves slowly)
+      if (++prot_n >= PROT_VBAT_EVERY && prot_vl_sw == sw_on) {
+        prot_n = 0;
+        prot_pend = VBAT_ADC;
+      }
+      // VL past the sense range, SW1 on so work it out from VSOL
+      else if (sw_on && (prot_clip || prot_clip_last)) prot_pend = VSOL_ADC;
+      else prot_pend = VL_ADC;
+      prot_pend_sw = sw_on;
+      adc_start(prot_pend);
+    }
+  }
+  // Battery Trip Levels, on each new VBAT code
+  if (prot_vbat_new) {
+    prot_vbat_new = 0;
+    if (prot_vbat > PROT_VBAT_MAX_CODE) {
+      prot_trip(F_OV);
+      return;
+    }
+    if (prot_vbat < PROT_VBAT_MIN_CODE) {
+      prot_trip(F_UV);
+      return;
+    }
+  }
+  // Inductor Current Estimate, VL less the winding drop
+  prot_il += prot_vl - VL_ZERO - ((prot_il * prot_il_decay) >> 16);
+  // Empty once VL settles at 0 with SW1 off (DCM), as SW1 was when VL
+  // was read (one tick back for the own Conversion)
+  if (prot_il < 0 || (!prot_vl_sw && prot_vl >= VL_ZERO - PROT_VL_NOISE)) prot_il = 0;
+  if (prot_il > prot_il_max) {
+    prot_trip(F_OC);
+    return;
+  }
+  // Track VL Swing over the Period (the pin, VSOL moves on its own)
+  if (prot_vl_pin < prot_vl_min) prot_vl_min = prot_vl_pin;
+  if (prot_vl_pin > prot_vl_max) prot_vl_max = prot_vl_pin;
+  // End of Period, VL has to move when SW1 switches
+  if (pwm_count == 0) {
+    if (prot_vl_max - prot_vl_min < PROT_VL_NOISE) {
+      if (++prot_stuck >= PROT_STUCK_PER) {
+        prot_trip(F_STUCK);
+        return;
+      }
+    } else prot_stuck = 0;
+    prot_vl_min = prot_vl_max = prot_vl_pin;
+  }
+}
+#endif
+
 ////////////////////////////////////////////////////////////////////////
 // PWM Handler Function
 // Runs off the base timer frequency, which is 100 times faster
 // PWM increments in by +- 1%
 // Set's state to INTEGRATE when PWM signal is high
 // Set's state to MPPT when PWM signal is low
+// With SYNC_SAMPLE also switches SW1 and samples VL at fixed ticks
+// With PROTECT runs protect() every tick
 ////////////////////////////////////////////////////////////////////////
 void pwm_handler() {
   // If Timer is ON
   if (timer_on) {
+#ifdef PROTECT
+    // No conversion taken yet this tick
+    prot_read = 0;
+#endif
     // If PWM Counter less than Duty Cycle (%)
     if (++pwm_count <= duty_cycle) {
+#ifdef SYNC_SAMPLE
+      // Start of On-Time, turn SW1 on and lay out the sample ticks
+      if (!sw_on) {
+        digitalWrite(SW1_PWM, HIGH);
+        sw_on = 1;
+        n_samples = 0;
+#ifdef PROTECT
+        // VL clipped last On-Time, protect() reads VSOL from the start
+        prot_clip_last = prot_clip;
+        prot_clip = 0;
+#endif
+        sample_duty = duty_cycle;
+        if (duty_cycle > BLANK_TICKS) {
+          // Equally spaced, each at the middle of its slice of the on-time
+          sample_step = (duty_cycle - BLANK_TICKS) / N_SAMPLES;
+          if (sample_step == 0) sample_step = 1;
+          sample_tick = BLANK_TICKS + 1 + sample_step / 2;
+        } else {
+          // On-Time shorter than blanking, single sample at the end
+          sample_step = 1;
+          sample_tick = duty_cycle;
+        }
+      }
+      // Sample Tick, take VL (and VSOL) conversion
+      if (pwm_count == sample_tick && n_samples < N_SAMPLES) {
+#ifdef PROTECT
+        // protect()'s conversion first (started a tick ago, done by now)
+        prot_collect();
+#endif
+#ifdef MPPT_RCC
+        vsol_samples[sample_buf][n_samples] = analogRead(VSOL_ADC);
+#endif
+        vl_samples[sample_buf][n_samples] = analogRead(VL_ADC);
+#ifdef PROTECT
+        // Protection reuses the sample (unless clipped and it has better)
+        if (vl_samples[sample_buf][n_samples] < ADC_MAX || prot_vl < ADC_MAX) prot_vl = vl_samples[sample_buf][n_samples];
+        prot_vl_pin = vl_samples[sample_buf][n_samples];
+        prot_vl_sw = 1;
+        if (prot_vl >= ADC_MAX) prot_clip = 1;
+        prot_read = 1;
+#endif
+        n_samples++;
+        sample_tick += sample_step;
+      }
+#endif
       // Set State to INTEGRATE
       cur_state = INTEGRATE;
       // If PWM Counter greater than Duty Cycle and less than 100
     } else if ((pwm_count > duty_cycle) && (pwm_count < 100)) {
+#ifdef SYNC_SAMPLE
+      // End of On-Time, turn SW1 off and hand the samples to mppt()
+      if (sw_on) {
+        digitalWrite(SW1_PWM, LOW);
+        sw_on = 0;
+        // Publish the filled buffer, the next On-Time fills the other
+        ready_buf = sample_buf;
+        ready_n = n_samples;
+        ready_step = sample_step;
+        ready_duty = sample_duty;
+        sample_buf ^= 1;
+        new_integral = 1;
+      }
+#endif
       // Set State MPPT
       cur_state = MPPT;
       // If PWM Counter Overflows, reset to 0
-    } else if (pwm_count >= 100) pwm_count = 0;
+    } else if (pwm_count >= 100) {
+#ifdef MPPT_RCC
+      // Last Off-Time tick, panel has recovered from the On-Time
+#ifdef PROTECT
+      prot_collect();
+#endif
+      vsol_rest = analogRead(VSOL_ADC);
+#ifdef PROTECT
+      prot_read = 1;
+#endif
+#endif
+      pwm_count = 0;
+    }
+#ifdef PROTECT
+    // Fast Path Protection
+    protect();
+#endif
   }
 }
 
@@ -128,6 +512,27 @@ void init_charger() {
   integral = 0;
   // Set new_integral to 0 (Algorithm starts in INTEGRATE after forced init and timer handler called)
   new_integral = 0;
+#ifdef SYNC_SAMPLE
+  // SW1 Off until pwm_handler starts the first On-Time
+  sw_on = 0;
+  n_samples = 0;
+  ready_n = 0;
+#endif
+#ifdef PROTECT
+  // Inductor starts empty, VL at 0 (Timer1 is already running, hold it
+  // off while the multi-byte state is written)
+  noInterrupts();
+  prot_il = 0;
+  prot_il_max = PROT_IL_CODES(settings.pwm_freq);
+  prot_il_decay = PROT_IL_DECAY(settings.pwm_freq);
+  prot_vl = prot_vl_pin = prot_vl_min = prot_vl_max = VL_ZERO;
+  prot_stuck = 0;
+  prot_n = 0;
+  prot_vbat_new = 0;
+  prot_vl_sw = 0;
+  prot_clip = prot_clip_last = 0;
+  interrupts();
+#endif
   // Reset Integral Average
   integral_avg = 0;
   // Set Duty Cycle Increase Flag
@@ -135,17 +540,43 @@ void init_charger() {
   duty_inc = 1;
   // Zero Out Power Tracking Variables (will read new cur on first and assume positive)
   p_prev = p_cur = 0;
+#ifdef MPPT_KF
+  // Fresh Power Estimate
+  kf_reset();
+#endif
+#ifdef MPPT_SETTLE
+  // Nothing settled yet
+  settle_last = 0;
+  settle_cnt = 0;
+#endif
   // Check Battery Level (Battery Only, Charger Not Running Yet)
   check_battery();
+#ifdef PROTECT
+  // VBAT code protect() works VL out from (VSOL - VBAT) until its first
+  // own VBAT conversion, from the reading just taken
+  noInterrupts();
+  prot_vbat = (int) (v_battery / VBAT_COEF);
+  interrupts();
+#endif
   // Check Solar Level
   check_solar();
+#ifndef SYNC_SAMPLE
   // Set VL prev to start integral
   vl_prev = VL_MEAS;
+#endif
   // Set Initial Duty Cycle (Vsol*D = Vbat => D = Vbat/Vsol)
   // Will target current battery level then MPPT will nagivate around that
   duty_cycle = (char) (100 * ((double) v_battery / (double) v_solar));
+#ifdef MPPT_RCC
+  // Tracker starts from the same point
+  rcc_duty = duty_cycle;
+  // Resting solar level until pwm_handler reads one
+  vsol_rest = adc_read(VSOL_ADC);
+#endif
+#ifndef SYNC_SAMPLE
   // Read Current Time, Set Both Previous and Current
   t_prev = t_cur = micros();
+#endif
   // Set First State to INTEGRATE
   cur_state = INTEGRATE;
   // Turn on Timer
@@ -157,6 +588,10 @@ void init_charger() {
 // Turns on switch and computes integral of inductor voltage
 ////////////////////////////////////////////////////////////////////////
 void integrate() {
+#ifdef SYNC_SAMPLE
+  // SW1 and VL sampling run from pwm_handler(), integrate_samples()
+  // computes the integral once the On-Time is over
+#else
   // Set SW1_PWM High (turn on SW1) if new_integral (just transitioned) then turn SW1 ON
   if (!new_integral) digitalWrite(SW1_PWM, HIGH);
   // Set new_integral flag to 1 (so MPPT can add when transitioned)
@@ -175,77 +610,400 @@ void integrate() {
   t_prev = t_cur;
   // Set Previous VL to Current
   vl_prev = vl_cur;
+#endif
+}
+
+#ifdef SYNC_SAMPLE
+////////////////////////////////////////////////////////////////////////
+// take_samples()
+// Copies the last finished On-Time out of pwm_handler()'s buffers with
+// interrupts held off, so a new On-Time starting can't change it while
+// the main loop works on it
+////////////////////////////////////////////////////////////////////////
+void take_samples() {
+  noInterrupts();
+  snap_n = ready_n;
+  snap_step = ready_step;
+  snap_duty = ready_duty;
+  for (unsigned char i = 0; i < snap_n; i++) {
+    snap_vl[i] = vl_samples[ready_buf][i];
+#ifdef MPPT_RCC
+    snap_vsol[i] = vsol_samples[ready_buf][i];
+#endif
+  }
+  interrupts();
+}
+
+////////////////////////////////////////////////////////////////////////
+// integrate_samples()
+// Computes the integral of inductor voltage from the On-Time samples
+// (take_samples() copy). Samples are equally spaced, so integral =
+// average VL * On-Time (us)
+////////////////////////////////////////////////////////////////////////
+void integrate_samples() {
+  long int vl_sum = 0;
+  double vl_avg;
+  // No samples (duty cycle 0)
+  if (snap_n == 0) {
+    integral = 0;
+    return;
+  }
+  // Sum VL Codes
+  for (unsigned char i = 0; i < snap_n; i++) vl_sum += snap_vl[i];
+  // Average VL
+  vl_avg = ((vl_sum / (double) snap_n) * ADC_COEF + VL_OFF) * VL_COEF;
+  // Multiply by On-Time (us)
+  integral = vl_avg * snap_duty * BASE_PER(settings.pwm_freq) * 1e6;
+}
+#endif
+
+#ifdef MPPT_RCC
+////////////////////////////////////////////////////////////////////////
+// rcc_step()
+// Moves the tracker duty cycle by step (%) and clamps it
+////////////////////////////////////////////////////////////////////////
+void rcc_step(double step) {
+  rcc_duty += step;
+  if (rcc_duty > settings.d_max) rcc_duty = settings.d_max;
+  if (rcc_duty < settings.d_min) rcc_duty = settings.d_min;
+  duty_cycle = (unsigned char) (rcc_duty + 0.5);
 }
 
+////////////////////////////////////////////////////////////////////////
+// rcc()
+// Ripple correlation control, runs once per period off the On-Time
+// samples (take_samples() copy). The panel swings across its I-V
+// curve during every On-Time, so the least squares slope of panel power
+// against panel voltage over the samples is dP/dV: positive left of the
+// MPP (raise the panel voltage, lower the duty cycle), negative right.
+// There is no panel current sensor, so the inductor current is the
+// integral of VL/L (DCM, empty when SW1 turns on) and the panel current
+// adds the input cap current, Ipv = IL + C*dV/dt. The slope is only
+// dP/dV at the operating point while the ripple stays on one side of
+// the knee. At partial sun the on-time swing crosses the whole knee and
+// it steers to a flat chord, well left of the best average duty cycle.
+////////////////////////////////////////////////////////////////////////
+void rcc() {
+  double v[N_SAMPLES], p[N_SAMPLES], vl, vl_last, i_l = 0, t0, dt, dv, h;
+  double v_avg = 0, p_avg = 0, svp = 0, svv = 0, slope;
+  unsigned char n = snap_n, k;
+  // Need at least 3 points for a slope through the ripple
+  if (n < 3) return;
+  // Time from SW1 on to the first sample, and between samples (s)
+  t0 = (BLANK_TICKS + snap_step / 2) * BASE_PER(settings.pwm_freq);
+  dt = snap_step * BASE_PER(settings.pwm_freq);
+  // Convert samples, p[] holds VL until it is integrated
+  for (k = 0; k < n; k++) {
+    v[k] = snap_vsol[k] * VSOL_COEF;
+    // VL sense clips at full scale, fall back to panel - battery
+    if (snap_vl[k] >= ADC_MAX) p[k] = v[k] - v_battery;
+    else p[k] = (snap_vl[k] * ADC_COEF + VL_OFF) * VL_COEF;
+  }
+  // VL at SW1 on, extrapolated back from the first two samples
+  vl_last = p[0] - (p[1] - p[0]) * t0 / dt;
+  // Inductor Current, trapezoid steps of L*di/dt = VL - R*i
+  for (k = 0; k < n; k++) {
+    vl = p[k];
+    h = k ? dt : t0;
+    i_l = (i_l * (1 - IND_R * h / (2 * IND_L)) + (vl_last + vl) / 2 * h / IND_L) / (1 + IND_R * h / (2 * IND_L));
+    vl_last = vl;
+    p[k] = i_l;
+  }
+  // Inductor must empty into the battery during the Off-Time (DCM),
+  // otherwise it starts the next period with current the sum misses
+  if (IND_L * i_l / v_battery > (100 - snap_duty) * BASE_PER(settings.pwm_freq)) {
+    // Back off one step toward DCM
+    rcc_step(-1);
+    return;
+  }
+  // Panel Power = V * (IL + C*dV/dt), central differences inside
+  for (k = 0; k < n; k++) {
+    if (k == 0) dv = (v[1] - v[0]) / dt;
+    else if (k == n - 1) dv = (v[k] - v[k - 1]) / dt;
+    else dv = (v[k + 1] - v[k - 1]) / (2 * dt);
+    p[k] = v[k] * (p[k] + CAP_IN * dv);
+    v_avg += v[k];
+    p_avg += p[k];
+  }
+  v_avg /= n;
+  p_avg /= n;
+  // Correlate AC components
+  for (k = 0; k < n; k++) {
+    svp += (v[k] - v_avg) * (p[k] - p_avg);
+    svv += (v[k] - v_avg) * (v[k] - v_avg);
+  }
+  // No ripple or no power, nothing to steer on
+  if (svv <= 0 || p_avg <= 0) return;
+  // Normalized slope (V/P)*dP/dV, limited to one full step
+  slope = (svp / svv) * v_avg / p_avg;
+  if (slope > 1) slope = 1;
+  if (slope < -1) slope = -1;
+  // Positive slope, raise panel voltage by lowering the duty cycle
+  rcc_step(-RCC_GAIN * slope);
+}
+#endif
+
+#ifndef MPPT_RCC
+////////////////////////////////////////////////////////////////////////
+// perturb_observe()
+// Perturb and observe step, moves the duty cycle 1% toward more power
+// from the p_cur / p_prev slope and the direction of the last step
+////////////////////////////////////////////////////////////////////////
+void perturb_observe() {
+  // If Power Slope Positive (left of peak)
+  // Did the Power Increase?
+  if (p_cur - p_prev > 0) {
+    // Did you Increase the Voltage (duty_cycle)?
+    // Yes then increase again (max power seeking)
+    if (duty_inc) {
+      if (++duty_cycle >= settings.d_max) duty_cycle = settings.d_max;
+      duty_inc = 1;
+    } else {
+      // Else Decrease
+      if (--duty_cycle <= settings.d_min) duty_cycle = settings.d_min;
+      duty_inc = 0;
+    }
+    // If Power Slope Negative (right of peak)
+  } else if (p_cur - p_prev < 0) {
+    // Did you Increase the Voltage (duty_cycle)?
+    if (duty_inc) {
+      // Yes, Then Decrease
+      if (--duty_cycle <= settings.d_min) duty_cycle = settings.d_min;
+      duty_inc = 0;
+    } else {
+      // Else increase again
+      if (++duty_cycle >= settings.d_max) duty_cycle = settings.d_max;
+      duty_inc = 1;
+    }
+  }
+}
+#endif
+
+#ifdef MPPT_KF
+////////////////////////////////////////////////////////////////////////
+// kf_reset()
+// Forgets the power estimate (charger start)
+////////////////////////////////////////////////////////////////////////
+void kf_reset() {
+  kf_p = kf_dp = 0;
+  kf_pp = kf_pd = kf_dd = 0;
+  // Noise seeded by the first measurement
+  kf_r = 0;
+  kf_p_step = kf_var_step = 0;
+  kf_conf = 0;
+  kf_known = 0;
+  kf_n = 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// kf_update()
+// One period of the power estimate, z is this period's v_battery *
+// integral. The state is the power level and its trend per period
+// (irradiance and temperature drift). A duty step moves the level but
+// not the trend, so after a step the first measurement becomes the
+// level and the trend carries over. Measurement noise (ADC noise on
+// VBAT and VL) adapts from the innovations, once the level is known.
+////////////////////////////////////////////////////////////////////////
+void kf_update(double z) {
+  double q, s, e, k_p, k_d;
+  kf_n++;
+  // First Measurement, noise starts at KF_R0 of it
+  if (kf_r <= 0) {
+    kf_r = (KF_R0 * z) * (KF_R0 * z);
+    if (kf_r < KF_R_FLOOR * KF_R_FLOOR) kf_r = KF_R_FLOOR * KF_R_FLOOR;
+  }
+  // Level unknown (after a Step), take the measurement as it
+  if (!kf_known) {
+    kf_p = z;
+    kf_pp = kf_r;
+    kf_pd = 0;
+    kf_known = 1;
+    return;
+  }
+  // Predict one Period, level follows the trend
+  q = KF_Q_P * kf_p;
+  kf_p += kf_dp;
+  kf_pp += 2 * kf_pd + kf_dd + q * q;
+  kf_pd += kf_dd;
+  q = KF_Q_D * kf_p;
+  kf_dd += q * q;
+  // Innovation and its Variance
+  e = z - kf_p;
+  s = kf_pp + kf_r;
+  // Gains
+  k_p = kf_pp / s;
+  k_d = kf_pd / s;
+  // Correct
+  kf_p += k_p * e;
+  kf_dp += k_d * e;
+  kf_dd -= k_d * kf_pd;
+  kf_pp *= kf_r / s;
+  kf_pd *= kf_r / s;
+  // Adapt Measurement Noise (innovations should have variance s), kept
+  // above KF_R_MIN of the power and KF_R_FLOOR so s stays positive
+  kf_r += (e * e - s) / KF_R_N;
+  q = KF_R_MIN * (fabs(kf_p) > fabs(z) ? fabs(kf_p) : fabs(z));
+  if (kf_r < q * q) kf_r = q * q;
+  if (kf_r < KF_R_FLOOR * KF_R_FLOOR) kf_r = KF_R_FLOOR * KF_R_FLOOR;
+}
+
+////////////////////////////////////////////////////////////////////////
+// kf_decide()
+// Checks whether the power change since the last step (less the trend
+// over the same periods) is KF_SIGMA standard deviations clear of the
+// noise, or num_int periods have passed. If so sets p_cur and p_prev
+// for perturb_observe() and starts the next step's estimate.
+////////////////////////////////////////////////////////////////////////
+bool kf_decide() {
+  double p_now, var;
+  // Level now without the drift since the Step
+  p_now = kf_p - kf_dp * num_integrals;
+  var = kf_pp + kf_var_step + (double) num_integrals * num_integrals * kf_dd;
+  kf_conf = var > 0 ? fabs(p_now - kf_p_step) / sqrt(var) : KF_SIGMA;
+  // Not clear yet (or no trend seen since the Step), wait another period
+  if ((kf_conf < KF_SIGMA || kf_n < KF_MIN_N) && num_integrals < settings.num_int) return 0;
+  // Slope for perturb_observe()
+  p_prev = kf_p_step;
+  p_cur = p_now;
+  // Next Step starts from here
+  kf_p_step = kf_p;
+  kf_var_step = kf_pp;
+  kf_known = 0;
+  kf_n = 0;
+  return 1;
+}
+#endif
+
+#ifdef MPPT_SETTLE
+////////////////////////////////////////////////////////////////////////
+// settle_update()
+// Counts the periods in a row the integral (power at a fixed battery
+// voltage) moved less than SETTLE_TOL from the period before. The first
+// period after a step only seeds settle_last, comparing it with the
+// period before the step would count a small step as settled.
+////////////////////////////////////////////////////////////////////////
+void settle_update() {
+  long d = integral - settle_last;
+  if (num_integrals > 1 && labs(d) <= labs(integral) * SETTLE_TOL) {
+    if (settle_cnt < 255) settle_cnt++;
+  } else settle_cnt = 0;
+  settle_last = integral;
+}
+
+////////////////////////////////////////////////////////////////////////
+// settled()
+// Power settled since the last step (min_int to num_int periods)
+////////////////////////////////////////////////////////////////////////
+bool settled() {
+  if (num_integrals >= settings.num_int) return 1;
+  return num_integrals >= settings.min_int && settle_cnt >= SETTLE_N;
+}
+#endif
+
 ////////////////////////////////////////////////////////////////////////
 // mppt()
 // checks to see if proper number of integrals have been averaged
 // if so, then runs maximum power point tracking and modifies duty cycle
 ////////////////////////////////////////////////////////////////////////
 void mppt() {
+#ifdef MPPT_KF
+  // Step decided this call
+  bool decide = 0;
+#endif
   // Check Battery Level
   check_battery();
+#ifdef MPPT_RCC
+  // Solar Level from the end of the Off-Time, right after SW1 turns off
+  // the On-Time ripple still holds the panel well below it
+  v_solar = vsol_rest * VSOL_COEF;
+#else
   // Check Solar Level
   check_solar();
+#endif
   // If don't have enough solar to charge battery
-  if (v_solar * D_MAX / 100.0 < v_battery) {
+  if (v_solar * settings.d_max / 100.0 < v_battery) {
     timer_on = 0;
     cur_state = DONE_CHG;
   }
   // If just transitioned to MPPT
   if (new_integral) {
+#ifdef SYNC_SAMPLE
+    // Integrate On-Time Samples
+    take_samples();
+    integrate_samples();
+#ifdef MPPT_RCC
+    // Track off this period's ripple
+    rcc();
+#endif
+#else
     // Set SW1_PWM Low (turn SW Off)
     digitalWrite(SW1_PWM, LOW);
+#endif
     // Add Integral to New Average
     integral_avg += integral;
     // Divide by 2
     integral_avg >>= 1;
     // Increment Integral Count
     num_integrals++;
+#ifdef MPPT_SETTLE
+    // Has the Power stopped moving since the last Step
+    settle_update();
+#endif
+#ifdef MPPT_KF
+    // Filter the Period's Power once the input cap settled after a Step
+    if (num_integrals > KF_SKIP || num_integrals >= settings.num_int) {
+      kf_update(v_battery * integral);
+      decide = kf_decide();
+    }
+#endif
     // Set New Integral to 0 (prevent re-entry)
     new_integral = 0;
     // Reset Integral Variable for next integration period
     integral = 0;
   }
-  // If Have All Integrals (NUM_INT)
-  if (num_integrals == NUM_INT) {
+#ifdef MPPT_KF
+  // If the Estimate is clear of the Noise (kf_decide() set the powers)
+  if (decide) {
+#else
+#ifdef MPPT_SETTLE
+  // If the Power settled since the last Step (settled() bounds the wait)
+  if (settled()) {
+    // Compute Power from the Period judged settled (integral_avg still
+    // holds the Periods before and just after the Step)
+    p_cur = v_battery * settle_last;
+#else
+  // If Have All Integrals (num_int, >= in case it was lowered mid-round)
+  if (num_integrals >= settings.num_int) {
     // Compute Power
     p_cur = v_battery * integral_avg;
-    // If Power Slope Positive (left of peak)
-    // Did the Power Increase?
-    if (p_cur - p_prev > 0) {
-      // Did you Increase the Voltage (duty_cycle)?
-      // Yes then increase again (max power seeking)
-      if (duty_inc) {
-        if (++duty_cycle >= D_MAX) duty_cycle = D_MAX;
-        duty_inc = 1;
-      } else {
-        // Else Decrease
-        if (--duty_cycle <= D_MIN) duty_cycle = D_MIN;
-        duty_inc = 0;
-      }
-      // If Power Slope Negative (right of peak)
-    } else if (p_cur - p_prev < 0) {
-      // Did you Increase the Voltage (duty_cycle)?
-      if (duty_inc) {
-        // Yes, Then Decrease
-        if (--duty_cycle <= D_MIN) duty_cycle = D_MIN;
-        duty_inc = 0;
-      } else {
-        // Else increase again
-        if (++duty_cycle >= D_MAX) duty_cycle = D_MAX;
-        duty_inc = 1;
-      }
-    }
+#endif
+#endif
+#ifndef MPPT_RCC
+    // Step the Duty Cycle
+    perturb_observe();
+#endif
     // Set Previous Power to Current
     p_prev = p_cur;
     // Reset Number of Integrals
     num_integrals = 0;
+#ifdef MPPT_SETTLE
+    // Settle again after this Step
+    settle_cnt = 0;
+#endif
 #ifdef CAL
     // Printout MPPT Values
     // v_battery, v_solar, integral_avg, p_cur, duty_cycle
-    sprintf(tempstr, "%f, %f, %d, %d, %d, %d", v_battery, v_solar, integral_avg, p_cur, duty_cycle, micros());
-    Serial.println(tempstr);
+    Serial.print(v_battery, 3);
+    Serial.print(F(", "));
+    Serial.print(v_solar, 3);
+    Serial.print(F(", "));
+    Serial.print(integral_avg);
+    Serial.print(F(", "));
+    Serial.print(p_cur, 0);
+    Serial.print(F(", "));
+    Serial.print(duty_cycle);
+    Serial.print(F(", "));
+    Serial.println(micros());
     // Increment number of MPTTs
     n_mppt += 1;
 #endif
@@ -262,19 +1020,45 @@ void done_charging() {
   timer_on = 0;
   // Turn Off SW1 (disconnect solar)
   digitalWrite(SW1_PWM, LOW);
+#ifdef SYNC_SAMPLE
+  sw_on = 0;
+#endif
 #ifdef CAL
-  Serial.println("Self Test Complete");
+#ifdef PROTECT
+  if (fault) {
+    Serial.print(F("Fault "));
+    Serial.println(fault);
+  }
+#endif
+  Serial.println(F("Self Test Complete"));
 #else
+#ifdef PROTECT
+  // Latched Fault, stay off until the console clears it (or power cycle)
+  if (fault) {
+    while (fault) {
+#ifdef CONSOLE
+      console_poll();
+#endif
+    }
+    resetFunc();
+  }
+#endif
   // Check Battery and Solar
   check_battery();
   check_solar();
   // If Battery Not Charged Anymore and Solar Voltage Good, then start charging
-  if ((v_battery < VCHARGE) && (v_solar * D_MAX / 100.0 >= v_battery)) cur_state = INIT_CHG;
-  // Sleep for SLEEP_TIME
+  if ((v_battery < settings.vcharge) && (v_solar * settings.d_max / 100.0 >= v_battery)) cur_state = INIT_CHG;
+  // Sleep for sleep_time
   // Ideally you would put the device to sleep and have some sort of RTC wake up
   // the system or better yet use an analog comparator that checks the battery
   // voltage and when it drops below charge level then wake up the system.
-  delay(SLEEP_TIME * 1000);
+#ifdef CONSOLE
+  // Keep servicing the console while asleep
+  unsigned long sleep_start = millis();
+  while (millis() - sleep_start < settings.sleep_time * 1000UL) console_poll();
+#else
+  delay(settings.sleep_time * 1000UL);
+#endif
   // Reset Device, Hard Reboot
   resetFunc();
 #endif
@@ -358,8 +1142,14 @@ void setup_charger() {
   timer_on = 0;
   // Set Current State to INIT_CHG (timer will change appropriately)
   cur_state = INIT_CHG;
+  // Load Default Settings
+  default_settings();
+#ifdef CONSOLE
+  // Setup Console (loads saved settings)
+  setup_console();
+#endif
   // Initialize Timer to BASE_PER (us)
-  Timer1.initialize(BASE_PER * 1e6);
+  Timer1.initialize(BASE_PER(settings.pwm_freq) * 1e6);
   // Attach Timer Intterupt Handler
   Timer1.attachInterrupt(pwm_handler);
 #ifdef CAL
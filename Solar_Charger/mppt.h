@@ -41,35 +41,76 @@
 // Macros
 ////////////////////////////////////////////////////////////////////////
 // Battery Voltage ADC Macro
-#define VBAT_MEAS (analogRead(VBAT_ADC)*VBAT_COEF)
+#define VBAT_MEAS (adc_read(VBAT_ADC)*VBAT_COEF)
 // Inductor Voltage ADC Macro
-#define VL_MEAS ((analogRead(VL_ADC)*ADC_COEF + VL_OFF)*VL_COEF)
+#define VL_MEAS ((adc_read(VL_ADC)*ADC_COEF + VL_OFF)*VL_COEF)
 // Solar Voltage ADC Macro
-#define VSOL_MEAS (analogRead(VSOL_ADC)*VSOL_COEF)
+#define VSOL_MEAS (adc_read(VSOL_ADC)*VSOL_COEF)
+// VL ADC Code at 0V across the Inductor
+#define VL_ZERO ((int) (-VL_OFF/ADC_COEF + 0.5))
+#ifdef PROTECT
+// Battery Trip Levels (ADC codes)
+#define PROT_VBAT_MAX_CODE ((int) (PROT_VBAT_MAX/VBAT_COEF))
+#define PROT_VBAT_MIN_CODE ((int) (PROT_VBAT_MIN/VBAT_COEF))
+// Over-Current Trip Level (VL codes above VL_ZERO summed per tick) at PWM Frequency F
+#define PROT_IL_CODES(F) ((long) (PROT_IL_MAX*IND_L/(ADC_COEF*VL_COEF*BASE_PER(F))))
+// VSOL and VBAT Codes as VL Codes (Q16), for VL = VSOL - VBAT past the VL sense range
+#define PROT_VSOL_K ((long) (VSOL_COEF/(ADC_COEF*VL_COEF)*65536.0 + 0.5))
+#define PROT_VBAT_K ((long) (VBAT_COEF/(ADC_COEF*VL_COEF)*65536.0 + 0.5))
+// Winding Drop per Tick at PWM Frequency F (R*dt/L, Q16)
+#define PROT_IL_DECAY(F) ((long) (IND_R*BASE_PER(F)/IND_L*65536.0 + 0.5))
+#endif
 
 ////////////////////////////////////////////////////////////////////////
 // Type Definitions
 ////////////////////////////////////////////////////////////////////////
 // State Variable Type Definition
-typedef enum _states {INIT_CHG, INTEGRATE, MPPT, DONE_CHG} STATES;
+typedef enum _states : unsigned char {INIT_CHG, INTEGRATE, MPPT, DONE_CHG} STATES;
+// Charger Settings Type Definition (runtime copies of config.h defaults)
+typedef struct _settings {
+  // Charge voltage (target)
+  double vcharge;
+  // Number of Integrals to Average Before MPPT
+  unsigned char num_int;
+#ifdef MPPT_SETTLE
+  // Fewest Periods between Steps (num_int is the most)
+  unsigned char min_int;
+#endif
+  // Minimum and Maximum Duty Cycle (%)
+  unsigned char d_min, d_max;
+  // PWM Frequency (Hz)
+  unsigned int pwm_freq;
+  // Sleep Time (s)
+  unsigned int sleep_time;
+} SETTINGS;
+#ifdef PROTECT
+// Latched Fault Code Type Definition
+typedef enum _faults : unsigned char {F_NONE, F_OV, F_UV, F_OC, F_STUCK} FAULTS;
+#endif
 
 ////////////////////////////////////////////////////////////////////////
 // Global Variables
 ////////////////////////////////////////////////////////////////////////
 // State Variable Definition
 extern volatile STATES cur_state;
+// Charger Settings
+extern SETTINGS settings;
 // Duty Cycle Variable
 extern volatile unsigned char duty_cycle;
 // Solar and Battery Voltage Variables
 extern volatile double v_solar, v_battery;
+#ifndef SYNC_SAMPLE
 // Inductor Current and Previous Voltage Variables
 extern volatile double vl_cur, vl_prev;
+#endif
 // MPPT Power Tracking Variables (for slopes)
 extern volatile double p_cur, p_prev;
 // Integral Variable
 extern volatile long int integral;
+#ifndef SYNC_SAMPLE
 // Time Tracking Variables (for dt integration)
 extern volatile unsigned long int t_cur, t_prev;
+#endif
 // Number of Integrations
 extern volatile unsigned char num_integrals;
 // Average Integral Value (over NUM_INT integrals)
@@ -78,16 +119,102 @@ extern volatile long int integral_avg;
 extern volatile unsigned char pwm_count;
 // New Integral Flag, Timer On Flag, and Duty Cycle Increase Flag
 extern volatile bool new_integral, timer_on, duty_inc;
+#ifdef SYNC_SAMPLE
+// VL Samples (ADC codes), pwm_handler fills one buffer while mppt()
+// reads the other
+extern volatile int vl_samples[2][N_SAMPLES];
+// Buffer being filled, Number of Samples Taken and Next Sample Tick
+extern volatile unsigned char sample_buf, n_samples, sample_tick;
+// Ticks between Samples and Duty Cycle the Samples were taken at
+extern volatile unsigned char sample_step, sample_duty;
+// Last finished On-Time: its Buffer, Sample Count, Step and Duty Cycle
+extern volatile unsigned char ready_buf, ready_n, ready_step, ready_duty;
+// Copy of the last finished On-Time for mppt() (take_samples())
+extern int snap_vl[N_SAMPLES];
+extern unsigned char snap_n, snap_step, snap_duty;
+// SW1 On Flag (set by pwm_handler)
+extern volatile bool sw_on;
+#endif
+#ifdef MPPT_RCC
+// Solar Voltage Samples (ADC codes), buffered like vl_samples
+extern volatile int vsol_samples[2][N_SAMPLES];
+// Copy of the last finished On-Time (take_samples())
+extern int snap_vsol[N_SAMPLES];
+// Solar Voltage (ADC code) at the end of the Off-Time
+extern volatile int vsol_rest;
+// Fractional Duty Cycle (%) the tracker integrates
+extern double rcc_duty;
+#endif
+#ifdef MPPT_KF
+// Filtered Power and its Trend (per period)
+extern double kf_p, kf_dp;
+// Standard Deviations the last Step was decided on
+extern double kf_conf;
+// Measurement Noise Variance, Level known since the last Step
+extern double kf_r;
+extern bool kf_known;
+// Measurements since the last Step
+extern unsigned char kf_n;
+#endif
+#ifdef MPPT_SETTLE
+// Last Period's Integral and Periods in a row it settled
+extern long settle_last;
+extern unsigned char settle_cnt;
+#endif
+#ifdef PROTECT
+// Latched Fault Code (F_NONE while running)
+extern volatile FAULTS fault;
+// Inductor Current Estimate and its Trip Level (VL codes summed per tick)
+extern volatile long prot_il, prot_il_max;
+// Winding Drop per Tick (Q16)
+extern volatile long prot_il_decay;
+// Last VL (ADC code)
+extern volatile int prot_vl;
+// Conversion already taken this Tick
+extern volatile bool prot_read;
+// Pin of the own Conversion still to be read back (0 = none)
+extern volatile unsigned char prot_pend;
+#endif
 
 ////////////////////////////////////////////////////////////////////////
 // Function Prototypes
 ////////////////////////////////////////////////////////////////////////
+extern void default_settings();
+extern void apply_settings();
+extern int adc_read(unsigned char pin);
 extern void check_battery();
 extern void check_solar();
+extern double battery_power();
+#ifdef PROTECT
+extern void adc_start(unsigned char pin);
+extern bool adc_busy();
+extern int adc_result();
+extern void prot_collect();
+extern void prot_trip(FAULTS code);
+extern void protect();
+#endif
 extern void pwm_handler();
 extern void charger_state_machine();
 extern void init_charger();
 extern void integrate();
+#ifdef SYNC_SAMPLE
+extern void take_samples();
+extern void integrate_samples();
+#endif
+#ifdef MPPT_RCC
+extern void rcc();
+#else
+extern void perturb_observe();
+#endif
+#ifdef MPPT_KF
+extern void kf_reset();
+extern void kf_update(double z);
+extern bool kf_decide();
+#endif
+#ifdef MPPT_SETTLE
+extern void settle_update();
+extern bool settled();
+#endif
 extern void mppt();
 extern void done_charging();
 extern void setup_charger();
@@ -0,0 +1,68 @@
+#!/bin/sh
+########################################################################
+# bench.sh
+# Hot path microbenchmarks on the host (simulator) or the board
+# by: Aistheta Gleason
+########################################################################
+# Usage:
+#   ./bench.sh host [name] [flags]   e.g. ./bench.sh host rcc -DMPPT_RCC
+#   ./bench.sh avr PORT [fqbn] [name]
+#   ./bench.sh compare A.csv B.csv
+# host builds the simulator with -DBENCH (g++), avr builds and uploads
+# the sketch with -DBENCH (arduino-cli, TimerOne) and reads the CSV back
+# at BENCH_BAUD. Results go to bench_results/<host|avr>[-name].csv so
+# float and integer variants, builds and boards can be compared later
+# (host ones are machine noise below a ns and are not committed, no
+# avr ones have been recorded yet).
+# compare prints per_call of both files side by side with the ratio.
+########################################################################
+
+DIR=$(dirname "$0")
+RES=$DIR/bench_results
+mkdir -p "$RES"
+
+case $1 in
+  host)
+    name=host${2:+-$2}
+    [ $# -ge 2 ] && shift
+    shift
+    OUT=$(mktemp -d)
+    trap 'rm -rf "$OUT"' EXIT
+    # shellcheck disable=SC2068
+    g++ -O2 -Wall -Wno-psabi -DBENCH $@ -I"$DIR/Simulator" -I"$DIR/Solar_Charger" \
+      -x c++ "$DIR/Solar_Charger/Solar_Charger.ino" -x none "$DIR"/Solar_Charger/*.cpp \
+      "$DIR/Simulator/arduino.cpp" "$DIR/Simulator/plant.cpp" "$DIR/Simulator/pv_model.cpp" \
+      "$DIR/Simulator/sim.cpp" -o "$OUT/bench" || exit 1
+    "$OUT/bench" | tee "$RES/$name.csv"
+    ;;
+  avr)
+    [ -n "$2" ] || { echo "usage: $0 avr PORT [fqbn] [name]" >&2; exit 1; }
+    PORT=$2
+    FQBN=${3:-arduino:avr:uno}
+    name=avr${4:+-$4}
+    OUT=$(mktemp -d)
+    trap 'rm -rf "$OUT"' EXIT
+    arduino-cli compile --fqbn "$FQBN" --build-path "$OUT" \
+      --build-property "compiler.cpp.extra_flags=-DBENCH" "$DIR/Solar_Charger" || exit 1
+    # Upload first, a reader on the port would eat avrdude's replies
+    arduino-cli upload --fqbn "$FQBN" --input-dir "$OUT" -p "$PORT" || exit 1
+    stty -F "$PORT" 115200 raw -echo hupcl || exit 1
+    # Opening the port resets the board, so the run starts over for us
+    timeout 60 sed -n '/^#/,/^END/p' < "$PORT" | tr -d '\r' > "$OUT/bench.csv"
+    grep -q '^END' "$OUT/bench.csv" || { echo "no END from $PORT" >&2; exit 1; }
+    tee "$RES/$name.csv" < "$OUT/bench.csv"
+    ;;
+  compare)
+    [ -f "$2" ] && [ -f "$3" ] || { echo "usage: $0 compare A.csv B.csv" >&2; exit 1; }
+    awk -F, 'FNR == 1 || /^END/ || $1 == "case" { next }
+      NR == FNR { a[$1 "," $2] = $3; unit_a[$1 "," $2] = $4; next }
+      ($1 "," $2) in a {
+        r = $3 > 0 ? a[$1 "," $2] / $3 : 0
+        printf "%-20s %-10s %10s %-7s %10s %-7s %6.2f\n", $1, $2, a[$1 "," $2], unit_a[$1 "," $2], $3, $4, r
+      }' "$2" "$3"
+    ;;
+  *)
+    sed -n '7,10s/^# //p' "$0" >&2
+    exit 1
+    ;;
+esac
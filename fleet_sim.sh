@@ -0,0 +1,35 @@
+#!/bin/sh
+########################################################################
+# fleet_sim.sh
+# Fleet aggregator against simulated boards on pseudo-terminals
+# by: Aistheta Gleason
+########################################################################
+# Usage: ./fleet_sim.sh [seconds] [log.csv]  (default 20, stdout)
+# Builds the simulator and Fleet/fleet.cpp, starts three simulated
+# chargers in real time on pseudo-terminals (full sun, a cloud at 5s,
+# a battery over-voltage fault at 8s) and polls them once a second.
+########################################################################
+
+DIR=$(dirname "$0")
+SECS=${1:-20}
+LOG=${2:-/dev/stdout}
+OUT=$(mktemp -d)
+trap 'kill $(jobs -p) 2> /dev/null; rm -rf "$OUT"' EXIT
+
+g++ -O2 -Wall -Wno-psabi -I"$DIR/Simulator" -I"$DIR/Solar_Charger" \
+  -x c++ "$DIR/Solar_Charger/Solar_Charger.ino" -x none "$DIR"/Solar_Charger/*.cpp \
+  "$DIR/Simulator/arduino.cpp" "$DIR/Simulator/plant.cpp" "$DIR/Simulator/pv_model.cpp" \
+  "$DIR/Simulator/sim.cpp" -o "$OUT/sim" || exit 1
+g++ -O2 -Wall "$DIR/Fleet/fleet.cpp" -o "$OUT/fleet" || exit 1
+
+# Boards (run a little past the poller so the last round is answered)
+T=$((SECS + 2))
+"$OUT/sim" --time $T --realtime --pty "$OUT/sun" 2> "$OUT/sun.log" &
+"$OUT/sim" --time $T --realtime --step 5:300 --pty "$OUT/cloud" 2> "$OUT/cloud.log" &
+"$OUT/sim" --time $T --realtime --fault ov:8 --pty "$OUT/fault" 2> "$OUT/fault.log" &
+# Wait for the links
+for unit in sun cloud fault; do
+  while [ ! -e "$OUT/$unit" ]; do sleep 0.1; done
+done
+
+"$OUT/fleet" --rounds "$SECS" --boot 0 --log "$LOG" sun="$OUT/sun" cloud="$OUT/cloud" fault="$OUT/fault"
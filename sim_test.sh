@@ -0,0 +1,71 @@
+#!/bin/sh
+########################################################################
+# sim_test.sh
+# Host checks of the firmware and simulator
+# by: Aistheta Gleason
+########################################################################
+# Usage: ./sim_test.sh
+# Builds the simulator and runs each check, prints PASS/FAIL per check
+# and exits non-zero if any failed.
+########################################################################
+
+DIR=$(dirname "$0")
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+FAILS=0
+
+g++ -O2 -march=native -Wall -Wno-psabi -I"$DIR/Simulator" -I"$DIR/Solar_Charger" \
+  -x c++ "$DIR/Solar_Charger/Solar_Charger.ino" -x none "$DIR"/Solar_Charger/*.cpp \
+  "$DIR/Simulator/arduino.cpp" "$DIR/Simulator/plant.cpp" "$DIR/Simulator/pv_model.cpp" \
+  "$DIR/Simulator/sim.cpp" -o "$OUT/sim" || exit 1
+
+# check NAME COMMAND..., passes when COMMAND exits 0
+check() {
+  name=$1
+  shift
+  if "$@" > "$OUT/$name.log" 2>&1; then
+    echo "PASS $name"
+  else
+    echo "FAIL $name"
+    sed 's/^/  /' "$OUT/$name.log"
+    FAILS=$((FAILS + 1))
+  fi
+}
+
+# Console refuses settings that aren't numbers in range (NaN, inf)
+console_nan() {
+  printf 'set vcharge nan\nset vcharge inf\nset num_int nan\nget vcharge\n' | \
+    "$OUT/sim" --time 0.1 --console 2> /dev/null | tr -d '\r' > "$OUT/console.txt"
+  cat "$OUT/console.txt"
+  [ "$(grep -c '^ERR range' "$OUT/console.txt")" -eq 3 ] && grep -q '^vcharge=14.00$' "$OUT/console.txt"
+}
+check console_nan console_nan
+
+# Batch (SIMD) panel solvers match the scalar pv_current() over V, G and T
+check check_pv "$OUT/sim" --check-pv
+
+# Injected fault KIND trips (only as KIND) and stays latched at every
+# phase of the PWM period, and SW1 is off within MAX_US (ov can also
+# be stopped by mppt()'s charge check first)
+prot_fault() {
+  "$OUT/sim" --fault "$1:5" --sweep 100 --quiet 2> "$OUT/fault.txt"
+  ret=$?
+  cat "$OUT/fault.txt"
+  worst=$(sed -n 's/.*worst \([0-9]*\) us.*/\1/p' "$OUT/fault.txt")
+  [ $ret -eq 0 ] && grep -q "^codes: $1 x[0-9]*$" "$OUT/fault.txt" && [ "$worst" -le "$2" ]
+}
+check prot_ov prot_fault ov 2000
+check prot_uv prot_fault uv 2000
+check prot_oc prot_fault oc 1500
+check prot_stuck prot_fault stuck 200000
+
+# Nothing trips in clean runs (full sun, and noisy ADC at 500W/m^2)
+prot_clean() {
+  "$OUT/sim" --time 30 --quiet "$@" 2> "$OUT/clean.txt"
+  cat "$OUT/clean.txt"
+  ! grep -q latched "$OUT/clean.txt"
+}
+check prot_clean prot_clean
+check prot_clean_noise prot_clean --irr 500 --noise 3
+
+exit $FAILS
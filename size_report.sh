@@ -0,0 +1,50 @@
+#!/bin/sh
+########################################################################
+# size_report.sh
+# Flash and RAM budget of each firmware build (live and CAL)
+# by: Aistheta Gleason
+########################################################################
+# Needs arduino-cli with the arduino:avr core and the TimerOne library.
+# Usage: ./size_report.sh [fqbn]  (default arduino:avr:uno, a Pro Mini
+# is e.g. arduino:avr:pro:cpu=8MHzatmega328)
+# Prints flash and static RAM per build, then the largest RAM symbols
+# when avr-nm is on the PATH. Static RAM excludes the stack, so keep
+# the "free" column well clear of zero (the console "stats" command
+# reports the live free_ram on the board).
+# No output has been recorded yet (see Memory Budget in README.md),
+# paste the first run for both builds there.
+########################################################################
+
+FQBN=${1:-arduino:avr:uno}
+SKETCH=$(dirname "$0")/Solar_Charger
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+
+printf '%-6s %8s %6s %6s %6s %6s\n' build flash "%" ram "%" free
+for build in live cal; do
+  case $build in
+    live) flags= ;;
+    cal) flags=-DCAL ;;
+  esac
+  log=$OUT/$build.log
+  if ! arduino-cli compile --fqbn "$FQBN" --build-path "$OUT/$build" \
+      --build-property "compiler.cpp.extra_flags=$flags" "$SKETCH" > "$log" 2>&1; then
+    echo "$build: build failed, see below" >&2
+    cat "$log" >&2
+    exit 1
+  fi
+  flash=$(sed -n 's/^Sketch uses \([0-9]*\) bytes (\([0-9]*\)%).*/\1 \2/p' "$log")
+  ram=$(sed -n 's/^Global variables use \([0-9]*\) bytes (\([0-9]*\)%).*leaving \([0-9]*\) bytes.*/\1 \2 \3/p' "$log")
+  # shellcheck disable=SC2086
+  printf '%-6s %8s %6s %6s %6s %6s\n' $build $flash $ram
+done
+
+# Largest RAM symbols (data and bss) per build
+if command -v avr-nm > /dev/null; then
+  for build in live cal; do
+    echo
+    echo "$build: largest RAM symbols (bytes)"
+    avr-nm --size-sort -C -r -S --radix=d "$OUT/$build"/*.elf | \
+      awk '$3 ~ /^[bBdD]$/ { $1 = ""; $3 = ""; printf "%6d%s\n", $2, substr($0, length($2) + 2) }' | head -10
+  done
+fi